@@ -0,0 +1,135 @@
+#ifndef DB_AGGREGATE_H
+#define DB_AGGREGATE_H
+
+#include <algorithm>
+#include <string>
+
+#include "batch.h"
+
+enum AggregateFunction
+{
+    AGGREGATE_COUNT,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX,
+    AGGREGATE_SUM
+};
+
+/*
+An aggregate over one column and its running result. Scans add whole
+batches, reading only the selected values of the column, so no row
+is ever copied out. min and max have no result until a row is added;
+count and sum start at 0, and sums wrap around like any uint64_t.
+sum only applies to ids, the only numeric column.
+*/
+class Aggregate
+{
+public:
+    AggregateFunction function;
+    Column column;
+    bool has_result;
+    uint64_t number;
+    std::string string;
+
+    Aggregate(AggregateFunction function, Column column)
+        : function(function), column(column), has_result(function == AGGREGATE_COUNT || function == AGGREGATE_SUM),
+          number(0)
+    {
+    }
+    uint32_t columns() const
+    {
+        /* The columns a batch must have filled for this aggregate */
+        return function == AGGREGATE_COUNT ? 0 : column_mask(column);
+    }
+    void add_number(uint64_t value)
+    {
+        switch (function)
+        {
+        case AGGREGATE_COUNT:
+            number++;
+            break;
+        case AGGREGATE_MIN:
+            number = has_result ? std::min(number, value) : value;
+            break;
+        case AGGREGATE_MAX:
+            number = has_result ? std::max(number, value) : value;
+            break;
+        case AGGREGATE_SUM:
+            number += value;
+        }
+        has_result = true;
+    }
+    void add_string(std::string_view value)
+    {
+        if (function == AGGREGATE_COUNT)
+        {
+            number++;
+        }
+        else if (!has_result || (function == AGGREGATE_MIN ? value < string : value > string))
+        {
+            string = value;
+        }
+        has_result = true;
+    }
+    void add_row(const RowView &row)
+    {
+        if (column == COLUMN_ID)
+        {
+            add_number(row.id());
+        }
+        else
+        {
+            add_string(row.string_column(column));
+        }
+    }
+    void add_batch(const Batch &batch)
+    {
+        if (batch.num_selected == 0)
+        {
+            return;
+        }
+        if (function == AGGREGATE_COUNT)
+        {
+            number += batch.num_selected;
+            return;
+        }
+        /* Reduce the batch on its own first, then fold it into the result once */
+        if (column == COLUMN_ID)
+        {
+            uint64_t value = batch.ids[batch.selection[0]];
+            for (uint32_t i = 1; i < batch.num_selected; i++)
+            {
+                uint64_t id = batch.ids[batch.selection[i]];
+                value = function == AGGREGATE_MIN ? std::min(value, id)
+                        : function == AGGREGATE_MAX ? std::max(value, id)
+                                                    : value + id;
+            }
+            add_number(value);
+            return;
+        }
+        auto value = [&](uint32_t i)
+        {
+            uint16_t position = batch.selection[i];
+            return stored_string(column == COLUMN_USERNAME ? batch.usernames[position] : batch.emails[position]);
+        };
+        std::string_view best = value(0);
+        for (uint32_t i = 1; i < batch.num_selected; i++)
+        {
+            std::string_view candidate = value(i);
+            if (function == AGGREGATE_MIN ? candidate < best : candidate > best)
+            {
+                best = candidate;
+            }
+        }
+        add_string(best);
+    }
+    std::string result() const
+    {
+        if (!has_result)
+        {
+            return "NULL";
+        }
+        return column == COLUMN_ID || function == AGGREGATE_COUNT ? std::to_string(number) : string;
+    }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef DB_BATCH_H
+#define DB_BATCH_H
+
+#include "row.h"
+
+/*
+A batch holds up to BATCH_SIZE rows in one array per column, the
+unit the batch executor hands from operator to operator: scans fill
+it a leaf run at a time with any filter already applied, and later
+operators narrow its selection vector, which lists the positions of
+the rows still selected in order. Only the columns a query reads are
+filled.
+*/
+const uint32_t BATCH_SIZE = 1024;
+
+/* A string predicate scans can evaluate while they fill a batch */
+struct StringFilter
+{
+    Column column;
+    const char *value;
+    bool prefix;
+};
+
+class Batch
+{
+public:
+    uint32_t columns;
+    uint32_t num_rows;
+    uint32_t num_selected;
+    uint16_t selection[BATCH_SIZE];
+    uint64_t ids[BATCH_SIZE];
+    char usernames[BATCH_SIZE][USERNAME_SIZE];
+    char emails[BATCH_SIZE][EMAIL_SIZE];
+
+    void *column_values(Column column)
+    {
+        switch (column)
+        {
+        case COLUMN_ID:
+            return ids;
+        case COLUMN_USERNAME:
+            return usernames;
+        default:
+            return emails;
+        }
+    }
+    void select_all()
+    {
+        for (uint32_t i = 0; i < num_rows; i++)
+        {
+            selection[i] = i;
+        }
+        num_selected = num_rows;
+    }
+};
+
+#endif
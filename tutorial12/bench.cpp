@@ -0,0 +1,604 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "database.h"
+
+/*
+Micro benchmarks for the embeddable API. The tree cannot split
+internal nodes yet, so every benchmark works on a table small enough
+to fit under a single internal root (at most 34 rows).
+*/
+#define BENCH_FILENAME "bench.db"
+#define BENCH_WAL_FILENAME "bench.db-wal"
+#define BENCH_ROWS 30
+#define BENCH_LOOKUPS_PER_THREAD 1000000
+#define BENCH_MAX_THREADS 8
+#define BENCH_ROWS_PER_ROUND 32
+#define BENCH_INSERT_ROUNDS 2000
+#define BENCH_COMMIT_ROUNDS 20
+#define BENCH_PAGE_SIZE_LOOKUPS 1000000
+#define BENCH_PAGE_SIZE_SCANS 2000
+#define BENCH_LEAF_SEARCHES 20000000
+#define BENCH_COUNTS 200000
+#define BENCH_INDEX_SEARCHES 2000000
+#define BENCH_LAYOUT_SCANS 2000
+#define BENCH_SERIALIZED_ROWS 10000000
+#define BENCH_COLD_OPENS 200
+#define BENCH_AGGREGATES 2000
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void remove_database()
+{
+    unlink(BENCH_FILENAME);
+    unlink(BENCH_WAL_FILENAME);
+}
+
+static Database *open_fresh_database()
+{
+    remove_database();
+    Database *database = Database::open(BENCH_FILENAME);
+    for (uint32_t i = 1; i <= BENCH_ROWS; i++)
+    {
+        std::string name = "user" + std::to_string(i);
+        std::string email = "person" + std::to_string(i) + "@example.com";
+        Row row(i, name.c_str(), email.c_str());
+        database->insert(row);
+    }
+    return database;
+}
+
+static void bench_concurrent_lookups()
+{
+    Database *database = open_fresh_database();
+
+    std::cout << "concurrent point lookups (" << BENCH_LOOKUPS_PER_THREAD << " per thread)" << std::endl;
+    for (uint32_t num_threads = 1; num_threads <= BENCH_MAX_THREADS; num_threads *= 2)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back([database, t]()
+                                 {
+                                     Row row;
+                                     for (uint32_t i = 0; i < BENCH_LOOKUPS_PER_THREAD; i++)
+                                     {
+                                         database->get((i + t) % BENCH_ROWS + 1, row);
+                                     }
+                                 });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        double elapsed = seconds_since(start);
+        std::cout << "  threads " << num_threads << ": "
+                  << (uint64_t)(num_threads * BENCH_LOOKUPS_PER_THREAD / elapsed) << " lookups/s" << std::endl;
+    }
+
+    delete database;
+    remove_database();
+}
+
+static void bench_concurrent_inserts()
+{
+    /*
+    Every round inserts BENCH_ROWS_PER_ROUND rows into a fresh table,
+    each thread into its own key range. Only the inserts are timed.
+    */
+    std::cout << "concurrent inserts into disjoint key ranges (" << BENCH_ROWS_PER_ROUND
+              << " rows x " << BENCH_INSERT_ROUNDS << " rounds)" << std::endl;
+    for (uint32_t num_threads = 1; num_threads <= BENCH_MAX_THREADS; num_threads *= 2)
+    {
+        uint32_t rows_per_thread = BENCH_ROWS_PER_ROUND / num_threads;
+        double elapsed = 0;
+        for (uint32_t round = 0; round < BENCH_INSERT_ROUNDS; round++)
+        {
+            remove_database();
+            Database *database = Database::open(BENCH_FILENAME);
+            /* Measure the latching, not the log syncs */
+            database->set_synchronous(false);
+
+            std::atomic<bool> go(false);
+            std::atomic<uint32_t> finished(0);
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < num_threads; t++)
+            {
+                threads.emplace_back([database, t, rows_per_thread, &go, &finished]()
+                                     {
+                                         while (!go)
+                                         {
+                                             std::this_thread::yield();
+                                         }
+                                         for (uint32_t i = 1; i <= rows_per_thread; i++)
+                                         {
+                                             Row row(t * rows_per_thread + i, "user", "person@example.com");
+                                             database->insert(row);
+                                         }
+                                         finished++;
+                                     });
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            go = true;
+            while (finished < num_threads)
+            {
+                std::this_thread::yield();
+            }
+            elapsed += seconds_since(start);
+
+            for (std::thread &thread : threads)
+            {
+                thread.join();
+            }
+            delete database;
+        }
+        std::cout << "  threads " << num_threads << ": "
+                  << (uint64_t)(BENCH_ROWS_PER_ROUND * BENCH_INSERT_ROUNDS / elapsed) << " inserts/s" << std::endl;
+    }
+    remove_database();
+}
+
+static void bench_transaction_commits()
+{
+    /*
+    Insert BENCH_ROWS rows per round, once committing every insert on
+    its own and once in a single transaction. Every commit syncs the
+    log, so this compares BENCH_ROWS syncs with one.
+    */
+    std::cout << "synced commits (" << BENCH_ROWS << " rows x " << BENCH_COMMIT_ROUNDS << " rounds)" << std::endl;
+    for (int batched = 0; batched <= 1; batched++)
+    {
+        double elapsed = 0;
+        for (uint32_t round = 0; round < BENCH_COMMIT_ROUNDS; round++)
+        {
+            remove_database();
+            Database *database = Database::open(BENCH_FILENAME);
+
+            auto start = std::chrono::steady_clock::now();
+            Transaction *transaction = batched ? database->begin_transaction() : nullptr;
+            for (uint32_t i = 1; i <= BENCH_ROWS; i++)
+            {
+                Row row(i, "user", "person@example.com");
+                database->insert(row, transaction);
+            }
+            if (batched)
+            {
+                database->commit(transaction);
+            }
+            elapsed += seconds_since(start);
+
+            delete database;
+        }
+        std::cout << "  " << (batched ? "one transaction: " : "autocommit: ")
+                  << (uint64_t)(BENCH_ROWS * BENCH_COMMIT_ROUNDS / elapsed) << " inserts/s" << std::endl;
+    }
+    remove_database();
+}
+
+static void bench_page_sizes()
+{
+    /*
+    Fill a table with two full leaves of each page size, then time the
+    inserts (every one synced), point lookups and full scans. Rates are
+    per row, since larger pages hold more rows.
+    */
+    std::cout << "page sizes (two full leaves per table)" << std::endl;
+    for (uint32_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE; page_size *= 4)
+    {
+        remove_database();
+        Database *database = Database::open(BENCH_FILENAME, page_size);
+        uint32_t num_rows = 2 * leaf_node_max_cells(page_size);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 1; i <= num_rows; i++)
+        {
+            Row row(i, "user", "person@example.com");
+            database->insert(row);
+        }
+        double insert_elapsed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        Row row;
+        for (uint32_t i = 0; i < BENCH_PAGE_SIZE_LOOKUPS; i++)
+        {
+            database->get(i % num_rows + 1, row);
+        }
+        double lookup_elapsed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t rows_scanned = 0;
+        for (uint32_t i = 0; i < BENCH_PAGE_SIZE_SCANS; i++)
+        {
+            database->scan([&rows_scanned](Row &)
+                           { rows_scanned++; });
+        }
+        double scan_elapsed = seconds_since(start);
+
+        std::cout << "  " << page_size / 1024 << "K (" << num_rows << " rows): "
+                  << (uint64_t)(num_rows / insert_elapsed) << " inserts/s, "
+                  << (uint64_t)(BENCH_PAGE_SIZE_LOOKUPS / lookup_elapsed) << " lookups/s, "
+                  << (uint64_t)(rows_scanned / scan_elapsed) << " scanned rows/s" << std::endl;
+        delete database;
+    }
+    remove_database();
+}
+
+static void bench_leaf_search()
+{
+    /* Search a full leaf of each page size, without the rest of a lookup */
+    std::cout << "leaf searches (" << BENCH_LEAF_SEARCHES << " per page size)" << std::endl;
+    for (uint32_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE; page_size *= 4)
+    {
+        void *page = calloc(1, page_size);
+        LeafNode leaf_node = page;
+        leaf_node.initialize_leaf_node(page_size);
+        uint32_t num_cells = leaf_node_max_cells(page_size);
+        for (uint32_t i = 0; i < num_cells; i++)
+        {
+            *leaf_node.leaf_node_key(i) = 2 * i + 1;
+        }
+        *leaf_node.leaf_node_num_cells() = num_cells;
+
+        auto start = std::chrono::steady_clock::now();
+        /* Keep the compiler from dropping the searches */
+        volatile uint32_t sink = 0;
+        for (uint32_t i = 0; i < BENCH_LEAF_SEARCHES; i++)
+        {
+            /* Spread the keys over the leaf, half of them missing */
+            sink = leaf_node.leaf_node_find_cell(i * 2654435761u % (2 * num_cells + 2), num_cells);
+        }
+        double elapsed = seconds_since(start);
+        (void)sink;
+        std::cout << "  " << page_size / 1024 << "K (" << num_cells << " cells): "
+                  << (uint64_t)(BENCH_LEAF_SEARCHES / elapsed) << " searches/s" << std::endl;
+        free(page);
+    }
+}
+
+static void bench_row_count()
+{
+    /* Count the rows from the root's row counts and by walking the leaves */
+    Database *database = open_fresh_database();
+
+    std::cout << "row counts (" << BENCH_ROWS << " rows, " << BENCH_COUNTS << " counts)" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BENCH_COUNTS; i++)
+    {
+        total += database->count();
+    }
+    double elapsed = seconds_since(start);
+    std::cout << "  count: " << (uint64_t)(BENCH_COUNTS / elapsed) << " counts/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_COUNTS; i++)
+    {
+        database->scan([&total](Row &)
+                       { total++; });
+    }
+    elapsed = seconds_since(start);
+    std::cout << "  scan: " << (uint64_t)(BENCH_COUNTS / elapsed) << " counts/s" << std::endl;
+
+    delete database;
+    remove_database();
+}
+
+static void bench_index_leaf()
+{
+    /* Fill an index leaf of each page size with emails, then search it */
+    std::cout << "index leaves (" << BENCH_INDEX_SEARCHES << " searches per page size)" << std::endl;
+    for (uint32_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE; page_size *= 4)
+    {
+        void *page = calloc(1, page_size);
+        IndexLeafNode leaf_node = page;
+        leaf_node.initialize_index_leaf_node(page_size);
+
+        /* Add keys in order like the index does, rewriting the leaf when its prefix shrinks */
+        std::vector<std::string> emails;
+        std::vector<std::string> keys;
+        std::vector<uint32_t> values;
+        uint32_t total_key_size = 0;
+        char key[INDEX_MAX_KEY_SIZE];
+        for (uint32_t i = 0;; i++)
+        {
+            char email[COLUMN_EMAIL_SIZE];
+            snprintf(email, sizeof(email), "person%06u@example.com", i);
+            uint32_t key_size = make_index_key(key, email, i);
+            keys.emplace_back(key, key_size);
+            values.push_back(0);
+            total_key_size += key_size;
+            if (!leaf_node.index_node_insert(keys.size() - 1, key, key_size, 0))
+            {
+                uint32_t prefix_size = common_prefix_size(keys.front(), keys.back());
+                if (leaf_node.index_node_size_for(keys.size(), total_key_size, prefix_size) > page_size)
+                {
+                    break;
+                }
+                leaf_node.index_node_write(keys, values, 0, keys.size());
+            }
+            emails.push_back(email);
+        }
+        uint32_t num_keys = *leaf_node.index_node_num_keys();
+
+        auto start = std::chrono::steady_clock::now();
+        volatile uint32_t sink = 0;
+        for (uint32_t i = 0; i < BENCH_INDEX_SEARCHES; i++)
+        {
+            std::string &email = emails[i * 2654435761u % num_keys];
+            uint32_t key_size = make_index_key(key, email.c_str(), 0);
+            sink = leaf_node.index_leaf_node_find_cell(key, key_size);
+        }
+        double elapsed = seconds_since(start);
+        (void)sink;
+        std::cout << "  " << page_size / 1024 << "K: " << num_keys << " keys of "
+                  << emails[0].size() + 1 + INDEX_ID_SIZE << " bytes, " << *leaf_node.index_node_prefix_size()
+                  << " byte prefix, " << (uint64_t)(BENCH_INDEX_SEARCHES / elapsed) << " searches/s" << std::endl;
+        free(page);
+    }
+}
+
+static void bench_leaf_layouts()
+{
+    /*
+    Scan two full 64K leaves of each layout: full scans copy out every
+    column, viewed scans read rows in place, filtered scans (an email
+    or one of 16 usernames, without an index) only read the ids and the
+    filtered column.
+    */
+    std::cout << "leaf layouts (" << BENCH_LAYOUT_SCANS << " scans per layout)" << std::endl;
+    const char *names[] = {"rows", "pax", "dict"};
+    for (LeafLayout layout : {LEAF_LAYOUT_ROWS, LEAF_LAYOUT_PAX, LEAF_LAYOUT_DICT})
+    {
+        remove_database();
+        Database *database = Database::open(BENCH_FILENAME, MAX_PAGE_SIZE, layout);
+        database->set_synchronous(false);
+        uint32_t num_rows = 2 * leaf_node_max_cells(MAX_PAGE_SIZE);
+        for (uint32_t i = 1; i <= num_rows; i++)
+        {
+            std::string email = "person" + std::to_string(i) + "@example.com";
+            std::string username = "user" + std::to_string(i % 16);
+            Row row(i, username.c_str(), email.c_str());
+            database->insert(row);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t rows_scanned = 0;
+        for (uint32_t i = 0; i < BENCH_LAYOUT_SCANS; i++)
+        {
+            database->scan([&rows_scanned](Row &)
+                           { rows_scanned++; });
+        }
+        double scan_elapsed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t rows_viewed = 0;
+        for (uint32_t i = 0; i < BENCH_LAYOUT_SCANS; i++)
+        {
+            database->scan_views(0, UINT32_MAX, [&rows_viewed](const RowView &)
+                                 { rows_viewed++; });
+        }
+        double view_elapsed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t rows_found = 0;
+        for (uint32_t i = 0; i < BENCH_LAYOUT_SCANS; i++)
+        {
+            database->find(COLUMN_EMAIL, "person7@example.com", false, [&rows_found](Row &)
+                           { rows_found++; });
+        }
+        double find_elapsed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_LAYOUT_SCANS; i++)
+        {
+            database->find(COLUMN_USERNAME, "user7", false, [&rows_found](Row &)
+                           { rows_found++; });
+        }
+        double find_username_elapsed = seconds_since(start);
+
+        std::cout << "  " << names[layout] << ": " << (uint64_t)(rows_scanned / scan_elapsed)
+                  << " scanned rows/s, " << (uint64_t)(rows_viewed / view_elapsed)
+                  << " viewed rows/s, " << (uint64_t)((uint64_t)num_rows * BENCH_LAYOUT_SCANS / find_elapsed)
+                  << " filtered rows/s, "
+                  << (uint64_t)((uint64_t)num_rows * BENCH_LAYOUT_SCANS / find_username_elapsed)
+                  << " filtered rows/s by username" << std::endl;
+        delete database;
+    }
+    remove_database();
+}
+
+static void serialize_row_padded(Row &source, void *destination)
+{
+    /* The fixed-width format rows were stored in before format 8 */
+    memcpy((char *)destination + ID_OFFSET, &(source.id), ID_SIZE);
+    strncpy((char *)destination + USERNAME_OFFSET, source.username, USERNAME_SIZE);
+    strncpy((char *)destination + EMAIL_OFFSET, source.email, EMAIL_SIZE);
+}
+
+static void bench_serialize_row()
+{
+    /*
+    Write rows into the cells of a 64K page, as bulk loads do. The
+    tree cannot hold 10M rows yet, so this leaves out the rest of the
+    insert path.
+    */
+    std::cout << "row serialization (" << BENCH_SERIALIZED_ROWS << " rows)" << std::endl;
+    std::vector<Row> rows;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        std::string name = "user" + std::to_string(i);
+        std::string email = "person" + std::to_string(i) + "@example.com";
+        rows.emplace_back(i, name.c_str(), email.c_str());
+    }
+    uint32_t num_cells = leaf_node_max_cells(MAX_PAGE_SIZE);
+    char *page = (char *)calloc(1, MAX_PAGE_SIZE);
+
+    const char *names[] = {"zero padded", "length-prefixed"};
+    for (uint32_t format = 0; format < 2; format++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_SERIALIZED_ROWS; i++)
+        {
+            char *cell = page + LEAF_NODE_HEADER_SIZE + i % num_cells * LEAF_NODE_CELL_SIZE + LEAF_NODE_KEY_SIZE;
+            if (format == 0)
+            {
+                serialize_row_padded(rows[i % rows.size()], cell);
+            }
+            else
+            {
+                serialize_row(rows[i % rows.size()], cell);
+            }
+        }
+        double elapsed = seconds_since(start);
+        /* Keep the compiler from dropping the writes */
+        volatile char sink = page[LEAF_NODE_HEADER_SIZE + LEAF_NODE_KEY_SIZE + USERNAME_OFFSET];
+        (void)sink;
+        std::cout << "  " << names[format] << ": " << (uint64_t)(BENCH_SERIALIZED_ROWS / elapsed) << " rows/s"
+                  << std::endl;
+    }
+    free(page);
+}
+
+static void bench_page_compression()
+{
+    /*
+    Write two full 64K leaves with each page compression, then open the
+    closed file again and again and scan it from the file.
+    */
+    std::cout << "page compression (" << BENCH_COLD_OPENS << " cold scans)" << std::endl;
+    const char *names[] = {"none", "lz"};
+    for (PageCompression compression : {PAGE_COMPRESSION_NONE, PAGE_COMPRESSION_LZ})
+    {
+        remove_database();
+        Database *database = Database::open(BENCH_FILENAME, MAX_PAGE_SIZE, LEAF_LAYOUT_ROWS, compression);
+        database->set_synchronous(false);
+        uint32_t num_rows = 2 * leaf_node_max_cells(MAX_PAGE_SIZE);
+        for (uint32_t i = 1; i <= num_rows; i++)
+        {
+            std::string name = "user" + std::to_string(i);
+            std::string email = "person" + std::to_string(i) + "@example.com";
+            Row row(i, name.c_str(), email.c_str());
+            database->insert(row);
+        }
+        delete database;
+        struct stat file_stat;
+        stat(BENCH_FILENAME, &file_stat);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t rows_scanned = 0;
+        for (uint32_t i = 0; i < BENCH_COLD_OPENS; i++)
+        {
+            database = Database::open(BENCH_FILENAME);
+            database->scan([&rows_scanned](Row &)
+                           { rows_scanned++; });
+            delete database;
+        }
+        double elapsed = seconds_since(start);
+        std::cout << "  " << names[compression] << ": " << file_stat.st_size << " bytes, "
+                  << (uint64_t)(rows_scanned / elapsed) << " cold scanned rows/s" << std::endl;
+    }
+    remove_database();
+}
+
+static void bench_aggregates()
+{
+    /*
+    Compute count(*), min(id) and max(id), then count(*) and sum(id)
+    of one of 16 usernames, over two full 64K leaves: as aggregates,
+    and by scanning or finding the rows and folding them in the caller
+    */
+    std::cout << "aggregates (" << BENCH_AGGREGATES << " queries each)" << std::endl;
+    remove_database();
+    Database *database = Database::open(BENCH_FILENAME, MAX_PAGE_SIZE);
+    database->set_synchronous(false);
+    uint32_t num_rows = 2 * leaf_node_max_cells(MAX_PAGE_SIZE);
+    for (uint32_t i = 1; i <= num_rows; i++)
+    {
+        std::string username = "user" + std::to_string(i % 16);
+        std::string email = "person" + std::to_string(i) + "@example.com";
+        Row row(i, username.c_str(), email.c_str());
+        database->insert(row);
+    }
+
+    uint64_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_AGGREGATES; i++)
+    {
+        std::vector<Aggregate> aggregates = {{AGGREGATE_COUNT, COLUMN_ID}, {AGGREGATE_MIN, COLUMN_ID},
+                                             {AGGREGATE_MAX, COLUMN_ID}};
+        database->aggregate(aggregates, nullptr);
+        total += aggregates[0].number + aggregates[1].number + aggregates[2].number;
+    }
+    double key_elapsed = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_AGGREGATES; i++)
+    {
+        uint64_t count = 0, min_id = UINT64_MAX, max_id = 0;
+        database->scan([&](Row &row)
+                       {
+                           count++;
+                           min_id = std::min(min_id, row.id);
+                           max_id = std::max(max_id, row.id); });
+        total += count + min_id + max_id;
+    }
+    double key_scan_elapsed = seconds_since(start);
+
+    StringFilter filter = {COLUMN_USERNAME, "user7", false};
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_AGGREGATES; i++)
+    {
+        std::vector<Aggregate> aggregates = {{AGGREGATE_COUNT, COLUMN_ID}, {AGGREGATE_SUM, COLUMN_ID}};
+        database->aggregate(aggregates, &filter);
+        total += aggregates[0].number + aggregates[1].number;
+    }
+    double filter_elapsed = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_AGGREGATES; i++)
+    {
+        uint64_t count = 0, sum = 0;
+        database->find(COLUMN_USERNAME, "user7", false, [&](Row &row)
+                       {
+                           count++;
+                           sum += row.id; });
+        total += count + sum;
+    }
+    double filter_find_elapsed = seconds_since(start);
+
+    std::cout << "  count, min, max: " << (uint64_t)(BENCH_AGGREGATES / key_elapsed) << " queries/s, scanned "
+              << (uint64_t)(BENCH_AGGREGATES / key_scan_elapsed) << " queries/s" << std::endl;
+    std::cout << "  filtered count, sum: " << (uint64_t)(BENCH_AGGREGATES / filter_elapsed)
+              << " queries/s, found " << (uint64_t)(BENCH_AGGREGATES / filter_find_elapsed) << " queries/s"
+              << std::endl;
+    delete database;
+    remove_database();
+}
+
+int main(void)
+{
+    bench_concurrent_lookups();
+    bench_concurrent_inserts();
+    bench_transaction_commits();
+    bench_page_sizes();
+    bench_leaf_search();
+    bench_row_count();
+    bench_index_leaf();
+    bench_leaf_layouts();
+    bench_serialize_row();
+    bench_page_compression();
+    bench_aggregates();
+    return 0;
+}
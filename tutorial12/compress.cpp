@@ -0,0 +1,166 @@
+#include <cstring>
+
+#include "compress.h"
+
+static uint32_t lz_hash(const uint8_t *bytes)
+{
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+static bool lz_write_length(uint8_t *&out, uint8_t *end, uint32_t length)
+{
+    /* The part of a length past the 15 that fits in the token */
+    for (; length >= 255; length -= 255)
+    {
+        if (out == end)
+        {
+            return false;
+        }
+        *out++ = 255;
+    }
+    if (out == end)
+    {
+        return false;
+    }
+    *out++ = length;
+    return true;
+}
+static bool lz_read_length(const uint8_t *&in, const uint8_t *end, uint32_t &length)
+{
+    uint8_t byte;
+    do
+    {
+        if (in == end)
+        {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+static bool lz_write_sequence(uint8_t *&out, uint8_t *end, const uint8_t *literals, uint32_t literal_length,
+                              uint32_t offset, uint32_t match_length)
+{
+    /* A match_length of 0 writes the last sequence, which has no match */
+    uint32_t match_code = match_length > 0 ? match_length - LZ_MIN_MATCH : 0;
+    if (out == end)
+    {
+        return false;
+    }
+    *out++ = (literal_length < 15 ? literal_length : 15) << 4 | (match_code < 15 ? match_code : 15);
+    if (literal_length >= 15 && !lz_write_length(out, end, literal_length - 15))
+    {
+        return false;
+    }
+    if ((uint32_t)(end - out) < literal_length)
+    {
+        return false;
+    }
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+    if (match_length == 0)
+    {
+        return true;
+    }
+    if (end - out < 2)
+    {
+        return false;
+    }
+    out[0] = offset & 0xff;
+    out[1] = offset >> 8;
+    out += 2;
+    return match_code < 15 || lz_write_length(out, end, match_code - 15);
+}
+uint32_t lz_compress(const void *source, uint32_t size, void *destination, uint32_t capacity)
+{
+    const uint8_t *in = (const uint8_t *)source;
+    uint8_t *out = (uint8_t *)destination;
+    uint8_t *end = out + capacity;
+
+    /* Last position of every hashed 4 bytes; stale entries fail the comparison */
+    uint32_t positions[1 << LZ_HASH_BITS] = {};
+    uint32_t pos = 0, literal_start = 0;
+    while (pos + LZ_MIN_MATCH <= size)
+    {
+        uint32_t hash = lz_hash(in + pos);
+        uint32_t candidate = positions[hash];
+        positions[hash] = pos;
+        if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || memcmp(in + candidate, in + pos, LZ_MIN_MATCH))
+        {
+            pos++;
+            continue;
+        }
+        uint32_t length = LZ_MIN_MATCH;
+        while (pos + length < size && in[candidate + length] == in[pos + length])
+        {
+            length++;
+        }
+        if (!lz_write_sequence(out, end, in + literal_start, pos - literal_start, pos - candidate, length))
+        {
+            return 0;
+        }
+        pos += length;
+        literal_start = pos;
+    }
+    if (!lz_write_sequence(out, end, in + literal_start, size - literal_start, 0, 0))
+    {
+        return 0;
+    }
+    return out - (uint8_t *)destination;
+}
+bool lz_decompress(const void *source, uint32_t size, void *destination, uint32_t destination_size)
+{
+    /* Checks every length and offset, a torn or stale block must not overrun */
+    const uint8_t *in = (const uint8_t *)source;
+    const uint8_t *in_end = in + size;
+    uint8_t *out = (uint8_t *)destination;
+    uint8_t *out_end = out + destination_size;
+    while (in < in_end)
+    {
+        uint8_t token = *in++;
+        uint32_t literal_length = token >> 4;
+        if (literal_length == 15 && !lz_read_length(in, in_end, literal_length))
+        {
+            return false;
+        }
+        if ((uint32_t)(in_end - in) < literal_length || (uint32_t)(out_end - out) < literal_length)
+        {
+            return false;
+        }
+        memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+        if (in == in_end)
+        {
+            break;
+        }
+
+        if (in_end - in < 2)
+        {
+            return false;
+        }
+        uint32_t offset = in[0] | in[1] << 8;
+        in += 2;
+        uint32_t match_length = token & 15;
+        if (match_length == 15 && !lz_read_length(in, in_end, match_length))
+        {
+            return false;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (uint32_t)(out - (uint8_t *)destination) ||
+            (uint32_t)(out_end - out) < match_length)
+        {
+            return false;
+        }
+        /* Byte by byte: a match may overlap the bytes it produces */
+        const uint8_t *match = out - offset;
+        for (uint32_t i = 0; i < match_length; i++)
+        {
+            out[i] = match[i];
+        }
+        out += match_length;
+    }
+    return out == out_end;
+}
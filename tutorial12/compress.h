@@ -0,0 +1,32 @@
+#ifndef DB_COMPRESS_H
+#define DB_COMPRESS_H
+
+#include <cstdint>
+
+/* How pages are stored in the db file, chosen when it is created */
+enum PageCompression
+{
+    PAGE_COMPRESSION_NONE,
+    PAGE_COMPRESSION_LZ
+};
+
+/*
+A small LZ77 block compressor in the style of LZ4, for whole pages.
+
+The compressed block is a sequence of (literals, match) pairs. Each
+starts with a token byte whose high four bits are the literal length
+and low four bits the match length minus LZ_MIN_MATCH; 15 means the
+length continues in the following bytes, 255 at a time. The literals
+follow, then the match as a 16-bit little-endian offset back into the
+output. The last pair has no match.
+*/
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+/* Returns the compressed size, or 0 if it would exceed capacity */
+uint32_t lz_compress(const void *source, uint32_t size, void *destination, uint32_t capacity);
+/* Returns false unless source decompresses to exactly destination_size bytes */
+bool lz_decompress(const void *source, uint32_t size, void *destination, uint32_t destination_size);
+
+#endif
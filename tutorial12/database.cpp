@@ -0,0 +1,403 @@
+#include <cerrno>
+
+#include "database.h"
+
+Database::Iterator::Iterator(Cursor *cursor) : cursor(cursor)
+{
+    if (cursor != nullptr && !cursor->end_of_table)
+    {
+        cursor->cursor_row(row);
+    }
+}
+Database::Iterator::Iterator(Iterator &&other) : cursor(other.cursor), row(other.row)
+{
+    other.cursor = nullptr;
+}
+Row &Database::Iterator::operator*()
+{
+    return row;
+}
+Database::Iterator &Database::Iterator::operator++()
+{
+    cursor->cursor_advance();
+    if (!cursor->end_of_table)
+    {
+        cursor->cursor_row(row);
+    }
+    return *this;
+}
+bool Database::Iterator::operator!=(const Iterator &other) const
+{
+    bool at_end = cursor == nullptr || cursor->end_of_table;
+    bool other_at_end = other.cursor == nullptr || other.cursor->end_of_table;
+    return !(at_end && other_at_end);
+}
+Database::Iterator::~Iterator()
+{
+    delete cursor;
+}
+
+Database::Database(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression)
+{
+    table = new Table(filename, page_size, layout, compression);
+    indexes[COLUMN_ID] = nullptr; // the table itself
+    indexes[COLUMN_USERNAME] = new Index(table, COLUMN_USERNAME);
+    indexes[COLUMN_EMAIL] = new Index(table, COLUMN_EMAIL);
+}
+Database *Database::open(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression)
+{
+    return new Database(filename, page_size, layout, compression);
+}
+uint32_t Database::get_page_size()
+{
+    return table->pager.get_page_size();
+}
+Transaction *Database::begin_transaction()
+{
+    return table->begin_transaction();
+}
+void Database::commit(Transaction *transaction)
+{
+    table->commit_transaction(transaction);
+}
+void Database::rollback(Transaction *transaction)
+{
+    table->rollback_transaction(transaction);
+}
+void Database::set_synchronous(bool synchronous)
+{
+    /* Without syncing the log, a crash may lose the last few commits */
+    table->synchronous = synchronous;
+}
+ExecuteResult Database::insert(Row &row, Transaction *transaction)
+{
+    Cursor *cursor = table->table_find(row.id, LATCH_EXCLUSIVE, transaction);
+
+    LeafNode leaf_node = table->pager.get_page(cursor->page_num);
+    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
+    if (cursor->cell_num < num_cells)
+    {
+        uint64_t key_at_index = *leaf_node.leaf_node_key(cursor->cell_num);
+        if (key_at_index == row.id)
+        {
+            delete cursor;
+            return EXECUTE_DUPLICATE_KEY;
+        }
+    }
+    cursor->leaf_node_insert(row.id, row);
+    for (Index *index : indexes)
+    {
+        if (index != nullptr && index->exists())
+        {
+            index->insert(cursor, row);
+        }
+    }
+    cursor->commit();
+
+    delete cursor;
+
+    return EXECUTE_SUCCESS;
+}
+bool Database::get(uint64_t id, Row &row, Transaction *transaction)
+{
+    for (uint32_t attempt = 0; attempt < OPTIMISTIC_MAX_RESTARTS; attempt++)
+    {
+        uint32_t page_num, version;
+        if (transaction != nullptr)
+        {
+            break;
+        }
+        if (!table->optimistic_find(id, page_num, version))
+        {
+            continue;
+        }
+        if (table->pager.is_page_pending(page_num))
+        {
+            /* Changed by an open transaction, read the committed leaf instead */
+            return get_committed(id, row);
+        }
+
+        /* Copy the row out of the leaf, then make sure it did not change */
+        LeafNode leaf_node = table->pager.get_page(page_num);
+        uint32_t num_cells = *leaf_node.leaf_node_num_cells();
+        if (num_cells > leaf_node_max_cells(table->pager.get_page_size()))
+        {
+            continue;
+        }
+        uint32_t cell_num = leaf_node.leaf_node_find_cell(id, num_cells);
+        bool found = cell_num < num_cells && *leaf_node.leaf_node_key(cell_num) == id;
+        Row copy;
+        if (found)
+        {
+            leaf_node.leaf_node_read_row(cell_num, copy);
+        }
+        if (leaf_node.validate_node_version(version))
+        {
+            if (found)
+            {
+                row = copy;
+            }
+            return found;
+        }
+    }
+
+    /*
+    Too much contention: wait for the writers with shared latches.
+    Transactions always read this way to see their own changes.
+    */
+    Cursor *cursor = table->table_find(id, LATCH_SHARED);
+    if (transaction == nullptr && table->pager.is_page_pending(cursor->page_num))
+    {
+        delete cursor;
+        return get_committed(id, row);
+    }
+
+    LeafNode leaf_node = table->pager.get_page(cursor->page_num);
+    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
+    bool found = cursor->cell_num < num_cells &&
+                 *leaf_node.leaf_node_key(cursor->cell_num) == id;
+    if (found)
+    {
+        cursor->cursor_row(row);
+    }
+
+    delete cursor;
+
+    return found;
+}
+bool Database::get_committed(uint64_t id, Row &row)
+{
+    /* Look the row up in a snapshot of the last commit */
+    uint64_t snapshot_ts = table->pager.begin_snapshot();
+    void *page = malloc(table->pager.get_page_size());
+
+    uint32_t page_num = table->root_page_num;
+    table->pager.read_page_version(page_num, snapshot_ts, page);
+    while (Node(page).get_node_type() == NODE_INTERNAL)
+    {
+        InternalNode internal_node = page;
+        page_num = *internal_node.internal_node_child(internal_node.internal_node_find_child(id));
+        table->pager.read_page_version(page_num, snapshot_ts, page);
+    }
+
+    LeafNode leaf_node = page;
+    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
+    uint32_t cell_num = leaf_node.leaf_node_find_cell(id, num_cells);
+    bool found = cell_num < num_cells && *leaf_node.leaf_node_key(cell_num) == id;
+    if (found)
+    {
+        leaf_node.leaf_node_read_row(cell_num, row);
+    }
+
+    free(page);
+    table->pager.end_snapshot(snapshot_ts);
+
+    return found;
+}
+void Database::scan(const std::function<void(Row &)> &callback, Transaction *transaction)
+{
+    scan(0, UINT32_MAX, callback, transaction);
+}
+void Database::scan(uint32_t offset, uint32_t limit, const std::function<void(Row &)> &callback,
+                    Transaction *transaction)
+{
+    Row row;
+    scan_views(offset, limit, [&](const RowView &view)
+               {
+                   view.to_row(row);
+                   callback(row); },
+               transaction);
+}
+void Database::scan_views(uint32_t offset, uint32_t limit, const std::function<void(const RowView &)> &callback,
+                          Transaction *transaction)
+{
+    Cursor *cursor = new Cursor(table, transaction, offset);
+
+    for (uint32_t i = 0; i < limit && !cursor->end_of_table; i++)
+    {
+        callback(cursor->cursor_row_view());
+        cursor->cursor_advance();
+    }
+
+    delete cursor;
+}
+void Database::scan_batches(uint32_t offset, uint32_t columns, const StringFilter *filter,
+                            const std::function<bool(Batch &)> &callback, Transaction *transaction)
+{
+    Cursor *cursor = new Cursor(table, transaction, offset);
+    Batch *batch = new Batch;
+
+    while (!cursor->end_of_table)
+    {
+        cursor->cursor_fill_batch(*batch, columns, filter);
+        if (!callback(*batch))
+        {
+            break;
+        }
+    }
+
+    delete batch;
+    delete cursor;
+}
+uint32_t Database::count(Transaction *transaction)
+{
+    return table->row_count(transaction);
+}
+void Database::aggregate(std::vector<Aggregate> &aggregates, const StringFilter *filter,
+                         Transaction *transaction)
+{
+    if (filter != nullptr && (filter->column == COLUMN_ID || has_index(filter->column)))
+    {
+        find(filter->column, filter->value, filter->prefix, [&](Row &row)
+             {
+                 for (Aggregate &aggregate : aggregates)
+                 {
+                     aggregate.add_row(RowView(row));
+                 } },
+             transaction);
+        return;
+    }
+
+    uint32_t columns = 0;
+    bool key_only = filter == nullptr;
+    for (Aggregate &aggregate : aggregates)
+    {
+        columns |= aggregate.columns();
+        key_only = key_only && (aggregate.function == AGGREGATE_COUNT ||
+                                (aggregate.column == COLUMN_ID && aggregate.function != AGGREGATE_SUM));
+    }
+    if (key_only)
+    {
+        uint64_t min_key, max_key;
+        uint32_t row_count = table->key_range(transaction, min_key, max_key);
+        for (Aggregate &aggregate : aggregates)
+        {
+            if (aggregate.function == AGGREGATE_COUNT)
+            {
+                aggregate.number = row_count;
+            }
+            else if (row_count > 0)
+            {
+                aggregate.add_number(aggregate.function == AGGREGATE_MIN ? min_key : max_key);
+            }
+        }
+        return;
+    }
+
+    scan_batches(0, columns, filter, [&](Batch &batch)
+                 {
+                     for (Aggregate &aggregate : aggregates)
+                     {
+                         aggregate.add_batch(batch);
+                     }
+                     return true; },
+                 transaction);
+}
+void Database::find(Column column, const char *value, bool prefix, const std::function<void(Row &)> &callback,
+                    Transaction *transaction)
+{
+    Row row;
+    if (column == COLUMN_ID)
+    {
+        /* An id that is not a number in range matches no row */
+        if (prefix || value[0] == '\0' || strspn(value, "0123456789") != strlen(value))
+        {
+            return;
+        }
+        errno = 0;
+        uint64_t id = strtoull(value, nullptr, 10);
+        if (errno != ERANGE && get(id, row, transaction))
+        {
+            callback(row);
+        }
+        return;
+    }
+
+    if (!has_index(column))
+    {
+        /* Scan with the filter pushed down and copy out only the rows that match */
+        StringFilter filter = {column, value, prefix};
+        scan_batches(0, ALL_COLUMNS, &filter, [&](Batch &batch)
+                     {
+                         for (uint32_t i = 0; i < batch.num_selected; i++)
+                         {
+                             uint16_t position = batch.selection[i];
+                             RowView view(&batch.ids[position], stored_string(batch.usernames[position]),
+                                          stored_string(batch.emails[position]));
+                             view.to_row(row);
+                             callback(row);
+                         }
+                         return true; },
+                     transaction);
+        return;
+    }
+
+    /* Rows are never removed, so every id in the index has its row */
+    std::vector<uint64_t> ids;
+    indexes[column]->find(value, prefix, transaction, ids);
+    for (uint64_t id : ids)
+    {
+        if (get(id, row, transaction))
+        {
+            callback(row);
+        }
+    }
+}
+ExecuteResult Database::create_index(Column column)
+{
+    /* Keep out all writers while the index is built from the table */
+    table->exclude_writers();
+    if (column == COLUMN_ID || indexes[column]->exists())
+    {
+        table->admit_writers();
+        return EXECUTE_INDEX_EXISTS;
+    }
+
+    std::vector<Row> rows;
+    scan([&rows](Row &row)
+         { rows.push_back(row); });
+
+    Cursor *cursor = table->table_find(0, LATCH_EXCLUSIVE);
+    uint32_t root_page_num = indexes[column]->build(cursor, rows);
+    cursor->commit();
+    delete cursor;
+    indexes[column]->set_root_page_num(root_page_num);
+    table->admit_writers();
+
+    /* Write the index's root to the header */
+    table->pager.checkpoint();
+    return EXECUTE_SUCCESS;
+}
+bool Database::has_index(Column column)
+{
+    return column != COLUMN_ID && indexes[column]->exists();
+}
+Database::Iterator Database::begin()
+{
+    return Iterator(new Cursor(table));
+}
+Database::Iterator Database::end()
+{
+    return Iterator(nullptr);
+}
+void Database::print_tree()
+{
+    table->pager.print_tree(table->root_page_num, 0);
+}
+void Database::close()
+{
+    for (Index *&index : indexes)
+    {
+        delete index;
+        index = nullptr;
+    }
+    delete table;
+    table = nullptr;
+}
+Database::~Database()
+{
+    if (table != nullptr)
+    {
+        close();
+    }
+}
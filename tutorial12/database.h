@@ -0,0 +1,114 @@
+#ifndef DB_DATABASE_H
+#define DB_DATABASE_H
+
+#include <functional>
+
+#include "aggregate.h"
+#include "index.h"
+
+/* Optimistic lookups retried before falling back to shared latches */
+#define OPTIMISTIC_MAX_RESTARTS 8
+
+/*
+Database is the embeddable C++ API of the engine. It owns a Table and
+exposes typed operations on rows, so callers can use the engine
+in-process instead of talking to the REPL.
+
+All operations may run on any number of threads at once. scan and
+iterators see the table as of the moment they started, no matter
+what is inserted while they run.
+
+Every insert commits on its own unless it is given a transaction.
+Changes made in a transaction are only seen by operations given the
+same transaction until it commits, and are undone if it rolls back.
+While a transaction is open it is the only writer; other inserts wait
+for it to finish. A transaction belongs to the thread that began it.
+*/
+class Database
+{
+private:
+    Table *table;
+    Index *indexes[NUM_COLUMNS]; // secondary indexes, by column
+
+    bool get_committed(uint64_t id, Row &row);
+
+public:
+    class Iterator
+    {
+    private:
+        Cursor *cursor;
+        Row row;
+
+    public:
+        Iterator(Cursor *cursor);
+        Iterator(Iterator &&other);
+        Row &operator*();
+        Iterator &operator++();
+        bool operator!=(const Iterator &other) const;
+        ~Iterator();
+    };
+
+    /* page_size, layout and compression only apply when the database file is created */
+    Database(const char *filename, uint32_t page_size = DEFAULT_PAGE_SIZE, LeafLayout layout = LEAF_LAYOUT_ROWS,
+             PageCompression compression = PAGE_COMPRESSION_NONE);
+    static Database *open(const char *filename, uint32_t page_size = DEFAULT_PAGE_SIZE,
+                          LeafLayout layout = LEAF_LAYOUT_ROWS, PageCompression compression = PAGE_COMPRESSION_NONE);
+    uint32_t get_page_size();
+
+    Transaction *begin_transaction();
+    void commit(Transaction *transaction);
+    void rollback(Transaction *transaction);
+    void set_synchronous(bool synchronous);
+
+    ExecuteResult insert(Row &row, Transaction *transaction = nullptr);
+    bool get(uint64_t id, Row &row, Transaction *transaction = nullptr);
+    void scan(const std::function<void(Row &)> &callback, Transaction *transaction = nullptr);
+    /* Scan at most limit rows, starting with the row at position offset */
+    void scan(uint32_t offset, uint32_t limit, const std::function<void(Row &)> &callback,
+              Transaction *transaction = nullptr);
+    /*
+    Scan like above, but hand out views of the rows in the table's
+    pages instead of copies. A view is only valid during its callback.
+    */
+    void scan_views(uint32_t offset, uint32_t limit, const std::function<void(const RowView &)> &callback,
+                    Transaction *transaction = nullptr);
+    uint32_t count(Transaction *transaction = nullptr);
+    /*
+    Scan the rows from position offset on in batches with the given
+    columns filled. Only the rows matching filter are copied into the
+    batches, all of them if it is null. The scan stops early once
+    callback returns false.
+    */
+    void scan_batches(uint32_t offset, uint32_t columns, const StringFilter *filter,
+                      const std::function<bool(Batch &)> &callback,
+                      Transaction *transaction = nullptr);
+
+    /*
+    Compute aggregates over the rows matching filter, all of them if
+    it is null, without copying rows out: filters on ids or indexed
+    columns look the rows up, others are pushed into a batch scan of
+    just the columns needed. count(*), min(id) and max(id) over the
+    whole table only read the root and the outermost leaves.
+    */
+    void aggregate(std::vector<Aggregate> &aggregates, const StringFilter *filter,
+                   Transaction *transaction = nullptr);
+    /*
+    Call callback for every row whose column equals value, or starts
+    with it if prefix is set. Lookups by id use the table and match no
+    row unless value is an id in decimal, lookups by username or email
+    use an index on the column if there is one. Otherwise they scan the
+    table with the filter pushed into the leaves and hand out every
+    match straight from the batch, within the scan's snapshot.
+    */
+    void find(Column column, const char *value, bool prefix, const std::function<void(Row &)> &callback,
+              Transaction *transaction = nullptr);
+    ExecuteResult create_index(Column column);
+    bool has_index(Column column);
+    Iterator begin();
+    Iterator end();
+    void print_tree();
+    void close();
+    ~Database();
+};
+
+#endif
@@ -1,9 +1,13 @@
 #include <iostream>
+#include <cerrno>
 #include <cstring>
 #include <string>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
-#include <fcntl.h>
-#include <unistd.h>
+#include "database.h"
+#include "server.h"
 
 enum MetaCommandResult
 {
@@ -21,957 +25,602 @@ enum PrepareResult
 enum StatementType
 {
     STATEMENT_INSERT,
-    STATEMENT_SELECT
+    STATEMENT_SELECT,
+    STATEMENT_BEGIN,
+    STATEMENT_COMMIT,
+    STATEMENT_ROLLBACK,
+    STATEMENT_CREATE_INDEX
 };
-enum ExecuteResult
-{
-    EXECUTE_SUCCESS,
-    EXECUTE_TABLE_FULL,
-    EXECUTE_DUPLICATE_KEY
-};
-enum NodeType
-{
-    NODE_INTERNAL,
-    NODE_LEAF
-};
-#define COLUMN_USERNAME_SIZE 32
-#define COLUMN_EMAIL_SIZE 255
-class Row
+class Statement
 {
 public:
-    uint32_t id;
-    char username[COLUMN_USERNAME_SIZE + 1];
-    char email[COLUMN_EMAIL_SIZE + 1];
-    Row()
-    {
-        id = 0;
-        username[0] = '\0';
-        email[0] = '\0';
-    }
-    Row(uint32_t id, const char *username, const char *email)
-    {
-        this->id = id;
-        strncpy(this->username, username, COLUMN_USERNAME_SIZE + 1);
-        strncpy(this->email, email, COLUMN_EMAIL_SIZE + 1);
-    }
-};
+    StatementType type;
+    Row row_to_insert;
 
-#define size_of_attribute(Struct, Attribute) sizeof(((Struct *)0)->Attribute)
+    /*
+    select [<aggregates>] [where <column> = <value>] [limit <n>]
+    [offset <k>], where the value may also be given as like <prefix>%.
+    Aggregates are separated by commas: count(*), count(<column>),
+    min(<column>), max(<column>) and sum(id). They take no limit or
+    offset.
+    */
+    std::vector<Aggregate> select_aggregates;
+    bool select_where;
+    Column where_column;
+    std::string where_value;
+    bool where_prefix;
+    uint32_t select_limit;
+    uint32_t select_offset;
+
+    /* create index on users(<column>) */
+    Column index_column;
+};
 
-const uint32_t ID_SIZE = size_of_attribute(Row, id);
-const uint32_t USERNAME_SIZE = size_of_attribute(Row, username);
-const uint32_t EMAIL_SIZE = size_of_attribute(Row, email);
-const uint32_t ID_OFFSET = 0;
-const uint32_t USERNAME_OFFSET = ID_OFFSET + ID_SIZE;
-const uint32_t EMAIL_OFFSET = USERNAME_OFFSET + USERNAME_SIZE;
-const uint32_t ROW_SIZE = ID_SIZE + USERNAME_SIZE + EMAIL_SIZE;
+/*
+A plan is what the parser compiles from the shape of a statement,
+i.e. its text with every literal replaced by a '?' parameter. It
+holds the parsed statement with a slot for each literal, so
+statements that only differ in their literals share one plan and
+only have to bind their parameters before execution.
+*/
+#define PLAN_NO_PARAM UINT32_MAX
 
-void serialize_row(Row &source, void *destination)
+class Plan
 {
-    memcpy((char *)destination + ID_OFFSET, &(source.id), ID_SIZE);
-    strncpy((char *)destination + USERNAME_OFFSET, source.username, USERNAME_SIZE);
-    strncpy((char *)destination + EMAIL_OFFSET, source.email, EMAIL_SIZE);
-}
+public:
+    StatementType type;
+    uint32_t num_params;
 
-void deserialize_row(void *source, Row &destination)
-{
-    memcpy(&(destination.id), (char *)source + ID_OFFSET, ID_SIZE);
-    strncpy(destination.username, (char *)source + USERNAME_OFFSET, USERNAME_SIZE);
-    strncpy(destination.email, (char *)source + EMAIL_OFFSET, EMAIL_SIZE);
-}
+    /* select, see Statement; the params slots index the literals */
+    std::vector<Aggregate> aggregates;
+    bool where;
+    Column where_column = COLUMN_ID;
+    bool where_prefix = false;
+    uint32_t where_param;
+    uint32_t limit_param;
+    uint32_t offset_param;
 
-#define TABLE_MAX_PAGES 100
-const uint32_t PAGE_SIZE = 4096;
+    /* create index */
+    Column index_column = COLUMN_ID;
 
-/*
- * Common Node Header Layout
- */
-const uint32_t NODE_TYPE_SIZE = sizeof(uint8_t);
-const uint32_t NODE_TYPE_OFFSET = 0;
-const uint32_t IS_ROOT_SIZE = sizeof(uint8_t);
-const uint32_t IS_ROOT_OFFSET = NODE_TYPE_SIZE;
-const uint32_t PARENT_POINTER_SIZE = sizeof(uint32_t);
-const uint32_t PARENT_POINTER_OFFSET = IS_ROOT_OFFSET + IS_ROOT_SIZE;
-const uint8_t COMMON_NODE_HEADER_SIZE =
-    NODE_TYPE_SIZE + IS_ROOT_SIZE + PARENT_POINTER_SIZE;
+    Plan() = default;
+    Plan(StatementType type, uint32_t num_params)
+        : type(type), num_params(num_params), where(false), where_param(PLAN_NO_PARAM),
+          limit_param(PLAN_NO_PARAM), offset_param(PLAN_NO_PARAM)
+    {
+    }
+};
 
-class Node
+#define PLAN_CACHE_CAPACITY 64
+
+class PlanCache
 {
-protected:
-    void *node;
+private:
+    typedef std::list<std::pair<std::string, Plan>> PlanList;
+
+    uint32_t capacity;
+    PlanList plans; // most recently used first
+    std::unordered_map<std::string, PlanList::iterator> plan_index;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
 
 public:
-    Node() {}
-    Node(void *node) : node(node) {}
+    PlanCache(uint32_t capacity) : capacity(capacity), hits(0), misses(0), evictions(0) {}
 
-    NodeType get_node_type()
-    {
-        uint8_t value = *((uint8_t *)((char *)node + NODE_TYPE_OFFSET));
-        return (NodeType)value;
-    }
-    void set_node_type(NodeType type)
-    {
-        *((uint8_t *)((char *)node + NODE_TYPE_OFFSET)) = (uint8_t)type;
-    }
-    void *get_node()
+    Plan *lookup(const std::string &shape);
+    Plan *insert(const std::string &shape, const Plan &plan);
+    void print_stats();
+};
+Plan *PlanCache::lookup(const std::string &shape)
+{
+    auto it = plan_index.find(shape);
+    if (it == plan_index.end())
     {
-        return node;
+        misses++;
+        return nullptr;
     }
-    bool is_node_root()
+    hits++;
+
+    // Move to the front of the LRU list
+    plans.splice(plans.begin(), plans, it->second);
+    return &it->second->second;
+}
+Plan *PlanCache::insert(const std::string &shape, const Plan &plan)
+{
+    if (plans.size() >= capacity)
     {
-        uint8_t value = *((uint8_t *)((char *)node + IS_ROOT_OFFSET));
-        return value == 1;
+        // Evict the least recently used plan
+        plan_index.erase(plans.back().first);
+        plans.pop_back();
+        evictions++;
     }
-    void set_node_root(bool is_root)
+    plans.emplace_front(shape, plan);
+    plan_index[shape] = plans.begin();
+    return &plans.front().second;
+}
+void PlanCache::print_stats()
+{
+    std::cout << "Plan cache:" << std::endl;
+    std::cout << "capacity: " << capacity << std::endl;
+    std::cout << "size: " << plans.size() << std::endl;
+    std::cout << "hits: " << hits << std::endl;
+    std::cout << "misses: " << misses << std::endl;
+    std::cout << "evictions: " << evictions << std::endl;
+}
+
+class DB
+{
+private:
+    Database *database;
+    PlanCache plan_cache;
+    Transaction *transaction; // open transaction, if any
+
+public:
+    DB(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression)
+        : plan_cache(PLAN_CACHE_CAPACITY), transaction(nullptr)
     {
-        *((uint8_t *)((char *)node + IS_ROOT_OFFSET)) = is_root ? 1 : 0;
+        database = Database::open(filename, page_size, layout, compression);
     }
-    uint32_t *node_parent()
+    void start();
+    void print_prompt();
+
+    bool parse_meta_command(std::string &command);
+    MetaCommandResult do_meta_command(std::string &command);
+
+    void normalize_statement(std::string &input_line, std::string &shape, std::vector<std::string> &params);
+    PrepareResult compile_plan(std::string &shape, Plan &plan);
+    PrepareResult compile_select(std::vector<std::string> &tokens, Plan &plan);
+    PrepareResult compile_create_index(std::vector<std::string> &tokens, Plan &plan);
+    PrepareResult bind_insert(std::vector<std::string> &params, Statement &statement);
+    PrepareResult bind_select(Plan &plan, std::vector<std::string> &params, Statement &statement);
+    PrepareResult prepare_statement(std::string &input_line, Statement &statement);
+    bool parse_statement(std::string &input_line, Statement &statement);
+    void execute_statement(Statement &statement);
+    ExecuteResult execute_insert(Statement &statement);
+    ExecuteResult execute_select(Statement &statement);
+    ExecuteResult execute_transaction(Statement &statement);
+    ExecuteResult execute_create_index(Statement &statement);
+
+    ~DB()
     {
-        return (uint32_t *)((char *)node + PARENT_POINTER_OFFSET);
+        delete database;
     }
-    virtual uint32_t get_node_max_key();
 };
-/*
- * Leaf Node Header Layout
- */
-const uint32_t LEAF_NODE_NUM_CELLS_SIZE = sizeof(uint32_t);
-const uint32_t LEAF_NODE_NUM_CELLS_OFFSET = COMMON_NODE_HEADER_SIZE;
-const uint32_t LEAF_NODE_NEXT_LEAF_SIZE = sizeof(uint32_t);
-const uint32_t LEAF_NODE_NEXT_LEAF_OFFSET =
-    LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NODE_NUM_CELLS_SIZE;
-const uint32_t LEAF_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE +
-                                       LEAF_NODE_NUM_CELLS_SIZE +
-                                       LEAF_NODE_NEXT_LEAF_SIZE;
-/*
- * Leaf Node Body Layout
- */
-const uint32_t LEAF_NODE_KEY_SIZE = sizeof(uint32_t);
-const uint32_t LEAF_NODE_KEY_OFFSET = 0;
-const uint32_t LEAF_NODE_VALUE_SIZE = ROW_SIZE;
-const uint32_t LEAF_NODE_VALUE_OFFSET =
-    LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE;
-const uint32_t LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
-const uint32_t LEAF_NODE_SPACE_FOR_CELLS = PAGE_SIZE - LEAF_NODE_HEADER_SIZE;
-const uint32_t LEAF_NODE_MAX_CELLS =
-    LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE;
-const uint32_t LEAF_NODE_RIGHT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) / 2;
-const uint32_t LEAF_NODE_LEFT_SPLIT_COUNT =
-    (LEAF_NODE_MAX_CELLS + 1) - LEAF_NODE_RIGHT_SPLIT_COUNT;
 
-class LeafNode : public Node
+void DB::print_prompt()
 {
-public:
-    LeafNode() {}
-    LeafNode(void *node) : Node(node) {}
+    std::cout << "db > ";
+}
 
-    void initialize_leaf_node()
-    {
-        set_node_type(NODE_LEAF);
-        set_node_root(false);
-        *leaf_node_num_cells() = 0;
-        *leaf_node_next_leaf() = 0; // 0 represents no sibling
-    }
-    uint32_t *leaf_node_num_cells()
+bool DB::parse_meta_command(std::string &command)
+{
+    if (command[0] == '.')
     {
-        return (uint32_t *)((char *)node + LEAF_NODE_NUM_CELLS_OFFSET);
+        switch (do_meta_command(command))
+        {
+        case META_COMMAND_SUCCESS:
+            return true;
+        case META_COMMAND_UNRECOGNIZED_COMMAND:
+            std::cout << "Unrecognized command: " << command << std::endl;
+            return true;
+        }
     }
-    void *leaf_node_cell(uint32_t cell_num)
+    return false;
+}
+MetaCommandResult DB::do_meta_command(std::string &command)
+{
+    if (command == ".exit")
     {
-        return (char *)node + LEAF_NODE_HEADER_SIZE + cell_num * LEAF_NODE_CELL_SIZE;
+        if (transaction != nullptr)
+        {
+            // An unfinished transaction is discarded
+            database->rollback(transaction);
+            transaction = nullptr;
+        }
+        database->close();
+        std::cout << "Bye!" << std::endl;
+        exit(EXIT_SUCCESS);
     }
-    uint32_t *leaf_node_key(uint32_t cell_num)
+    else if (command == ".btree")
     {
-        return (uint32_t *)leaf_node_cell(cell_num);
+        std::cout << "Tree:" << std::endl;
+        database->print_tree();
+        return META_COMMAND_SUCCESS;
     }
-    void *leaf_node_value(uint32_t cell_num)
+    else if (command == ".constants")
     {
-        return (char *)leaf_node_cell(cell_num) + LEAF_NODE_KEY_SIZE;
+        uint32_t page_size = database->get_page_size();
+        std::cout << "Constants:" << std::endl;
+        std::cout << "PAGE_SIZE: " << page_size << std::endl;
+        std::cout << "ROW_SIZE: " << ROW_SIZE << std::endl;
+        std::cout << "COMMON_NODE_HEADER_SIZE: " << COMMON_NODE_HEADER_SIZE << std::endl;
+        std::cout << "LEAF_NODE_HEADER_SIZE: " << LEAF_NODE_HEADER_SIZE << std::endl;
+        std::cout << "LEAF_NODE_CELL_SIZE: " << LEAF_NODE_CELL_SIZE << std::endl;
+        std::cout << "LEAF_NODE_SPACE_FOR_CELLS: " << leaf_node_space_for_cells(page_size) << std::endl;
+        std::cout << "LEAF_NODE_MAX_CELLS: " << leaf_node_max_cells(page_size) << std::endl;
+        return META_COMMAND_SUCCESS;
     }
-    uint32_t get_node_max_key() override
+    else if (command == ".plancache")
     {
-        return *leaf_node_key(*leaf_node_num_cells() - 1);
+        plan_cache.print_stats();
+        return META_COMMAND_SUCCESS;
     }
-    u_int32_t *leaf_node_next_leaf()
+    else
     {
-        return (u_int32_t *)((char *)node + LEAF_NODE_NEXT_LEAF_OFFSET);
+        return META_COMMAND_UNRECOGNIZED_COMMAND;
     }
-};
-
-/*
- * Internal Node Header Layout
- */
-const uint32_t INTERNAL_NODE_NUM_KEYS_SIZE = sizeof(uint32_t);
-const uint32_t INTERNAL_NODE_NUM_KEYS_OFFSET = COMMON_NODE_HEADER_SIZE;
-const uint32_t INTERNAL_NODE_RIGHT_CHILD_SIZE = sizeof(uint32_t);
-const uint32_t INTERNAL_NODE_RIGHT_CHILD_OFFSET =
-    INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE;
-const uint32_t INTERNAL_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE +
-                                           INTERNAL_NODE_NUM_KEYS_SIZE +
-                                           INTERNAL_NODE_RIGHT_CHILD_SIZE;
-/*
- * Internal Node Body Layout
- */
-const uint32_t INTERNAL_NODE_KEY_SIZE = sizeof(uint32_t);
-const uint32_t INTERNAL_NODE_CHILD_SIZE = sizeof(uint32_t);
-const uint32_t INTERNAL_NODE_CELL_SIZE =
-    INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_SIZE;
-/* Keep this small for testing */
-const uint32_t INTERNAL_NODE_MAX_CELLS = 3;
+}
 
-class InternalNode : public Node
+static bool is_literal(const std::string &keyword, const std::string &previous_token)
 {
-public:
-    InternalNode() {}
-    InternalNode(void *node) : Node(node) {}
-
-    void initialize_internal_node()
-    {
-        set_node_type(NODE_INTERNAL);
-        set_node_root(false);
-        *internal_node_num_keys() = 0;
-    }
-    uint32_t *internal_node_num_keys()
-    {
-        return (uint32_t *)((char *)node + INTERNAL_NODE_NUM_KEYS_OFFSET);
-    }
-    u_int32_t *internal_node_right_child()
-    {
-        return (u_int32_t *)((char *)node + INTERNAL_NODE_RIGHT_CHILD_OFFSET);
-    }
-    uint32_t *internal_node_cell(uint32_t cell_num)
-    {
-        return (uint32_t *)((char *)node + INTERNAL_NODE_HEADER_SIZE + cell_num * INTERNAL_NODE_CELL_SIZE);
-    }
-    uint32_t *internal_node_child(uint32_t child_num)
+    /* Every value of an insert is a literal, elsewhere only the operand of =, like, limit or offset */
+    return keyword == "insert" || previous_token == "=" || previous_token == "like" || previous_token == "limit" ||
+           previous_token == "offset";
+}
+void DB::normalize_statement(std::string &input_line, std::string &shape, std::vector<std::string> &params)
+{
+    /*
+    Split the statement on spaces. Keywords are kept as they are,
+    every literal becomes a '?' in the shape and is handed back in
+    params for binding.
+    */
+    std::string keyword, previous_token;
+    size_t pos = 0;
+    while (pos < input_line.size())
     {
-        uint32_t num_keys = *internal_node_num_keys();
-        if (child_num > num_keys)
+        size_t start = input_line.find_first_not_of(' ', pos);
+        if (start == std::string::npos)
         {
-            std::cout << "Tried to access child_num " << child_num << " > num_keys " << num_keys << std::endl;
-            exit(EXIT_FAILURE);
+            break;
         }
-        else if (child_num == num_keys)
+        size_t end = input_line.find(' ', start);
+        if (end == std::string::npos)
         {
-            return internal_node_right_child();
+            end = input_line.size();
+        }
+
+        std::string token = input_line.substr(start, end - start);
+        if (shape.empty())
+        {
+            shape = keyword = token;
+        }
+        else if (is_literal(keyword, previous_token))
+        {
+            params.push_back(token);
+            token = "?";
+            shape += " ?";
         }
         else
         {
-            return internal_node_cell(child_num);
+            shape += " " + token;
         }
+        previous_token = token;
+        pos = end;
     }
-    uint32_t *internal_node_key(uint32_t key_num)
+}
+static bool parse_column(const std::string &name, Column &column)
+{
+    if (name == "id")
     {
-        return internal_node_cell(key_num) + INTERNAL_NODE_CHILD_SIZE / sizeof(uint32_t);
+        column = COLUMN_ID;
     }
-    uint32_t get_node_max_key() override
+    else if (name == "username")
     {
-        return *internal_node_key(*internal_node_num_keys() - 1);
+        column = COLUMN_USERNAME;
     }
-    uint32_t internal_node_find_child(uint32_t key)
+    else if (name == "email")
     {
-        /*
-        Return the index of the child which should contain
-        the given key.
-        */
-
-        uint32_t num_keys = *internal_node_num_keys();
-
-        /* Binary search */
-        uint32_t min_index = 0;
-        uint32_t max_index = num_keys; /* there is one more child than key */
-
-        while (min_index != max_index)
-        {
-            uint32_t index = (min_index + max_index) / 2;
-            uint32_t key_to_right = *internal_node_key(index);
-            if (key_to_right >= key)
-            {
-                max_index = index;
-            }
-            else
-            {
-                min_index = index + 1;
-            }
-        }
-
-        return min_index;
-    }
-    void update_internal_node_key(uint32_t old_key, uint32_t new_key)
-    {
-        uint32_t old_child_index = internal_node_find_child(old_key);
-        *internal_node_key(old_child_index) = new_key;
-    }
-};
-uint32_t Node::get_node_max_key()
-{
-    if (get_node_type() == NODE_LEAF)
-    {
-        LeafNode *leaf_node = (LeafNode *)this;
-        return *leaf_node->leaf_node_key(*leaf_node->leaf_node_num_cells() - 1);
+        column = COLUMN_EMAIL;
     }
     else
     {
-        InternalNode *internal_node = (InternalNode *)this;
-        return *internal_node->internal_node_key(*internal_node->internal_node_num_keys() - 1);
+        return false;
     }
+    return true;
 }
-
-class Pager
+static bool parse_aggregate(const std::string &text, std::vector<Aggregate> &aggregates)
 {
-private:
-    int file_descriptor;
-    uint32_t file_length;
-    void *pages[TABLE_MAX_PAGES];
-    uint32_t num_pages;
-
-public:
-    Pager(const char *filename);
-
-    void *get_page(uint32_t page_num);
-    void pager_flush(uint32_t page_num);
-    void print_tree(uint32_t page_num, uint32_t indentation_level);
-    uint32_t get_unused_page_num();
-
-    friend class Table;
-};
-Pager::Pager(const char *filename)
-{
-    file_descriptor = open(filename,
-                           O_RDWR |     // Read/Write mode
-                               O_CREAT, // Create file if it does not exist
-                           S_IWUSR |    // User write permission
-                               S_IRUSR  // User read permission
-    );
-    if (file_descriptor < 0)
-    {
-        std::cerr << "Error: cannot open file " << filename << std::endl;
-        exit(EXIT_FAILURE);
+    size_t open = text.find('(');
+    if (open == std::string::npos || text.back() != ')')
+    {
+        return false;
     }
-
-    file_length = lseek(file_descriptor, 0, SEEK_END);
-    num_pages = file_length / PAGE_SIZE;
-
-    if (file_length % PAGE_SIZE != 0)
+    std::string function = text.substr(0, open);
+    std::string argument = text.substr(open + 1, text.size() - open - 2);
+    Column column = COLUMN_ID;
+    if (function == "count" && argument == "*")
     {
-        std::cerr << "Db file is not a whole number of pages. Corrupt file." << std::endl;
-        exit(EXIT_FAILURE);
+        aggregates.emplace_back(AGGREGATE_COUNT, COLUMN_ID);
+        return true;
     }
-
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    if (!parse_column(argument, column))
     {
-        pages[i] = nullptr;
+        return false;
     }
-}
-void *Pager::get_page(uint32_t page_num)
-{
-    if (page_num > TABLE_MAX_PAGES)
+    if (function == "count")
     {
-        std::cout << "Tried to fetch page number out of bounds. " << page_num << " > "
-                  << TABLE_MAX_PAGES << std::endl;
-        exit(EXIT_FAILURE);
+        aggregates.emplace_back(AGGREGATE_COUNT, column);
     }
-
-    if (pages[page_num] == nullptr)
+    else if (function == "min")
     {
-        // Cache miss. Allocate memory and load from file.
-        void *page = malloc(PAGE_SIZE);
-        uint32_t num_pages = file_length / PAGE_SIZE;
-
-        // We might save a partial page at the end of the file
-        if (file_length % PAGE_SIZE)
-        {
-            num_pages += 1;
-        }
-
-        if (page_num <= num_pages)
-        {
-            lseek(file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-            ssize_t bytes_read = read(file_descriptor, page, PAGE_SIZE);
-            if (bytes_read == -1)
-            {
-                std::cout << "Error reading file: " << errno << std::endl;
-                exit(EXIT_FAILURE);
-            }
-        }
-
-        pages[page_num] = page;
-
-        if (page_num >= num_pages)
-        {
-            this->num_pages = page_num + 1;
-        }
+        aggregates.emplace_back(AGGREGATE_MIN, column);
     }
-
-    return pages[page_num];
-}
-void Pager::pager_flush(uint32_t page_num)
-{
-    if (pages[page_num] == nullptr)
+    else if (function == "max")
     {
-        std::cout << "Tried to flush null page" << std::endl;
-        exit(EXIT_FAILURE);
+        aggregates.emplace_back(AGGREGATE_MAX, column);
     }
-
-    off_t offset = lseek(file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-
-    if (offset == -1)
+    else if (function == "sum" && column == COLUMN_ID)
     {
-        std::cout << "Error seeking: " << errno << std::endl;
-        exit(EXIT_FAILURE);
+        aggregates.emplace_back(AGGREGATE_SUM, column);
     }
-
-    ssize_t bytes_written =
-        write(file_descriptor, pages[page_num], PAGE_SIZE);
-
-    if (bytes_written == -1)
+    else
     {
-        std::cout << "Error writing: " << errno << std::endl;
-        exit(EXIT_FAILURE);
+        return false;
     }
+    return true;
 }
-void indent(uint32_t level)
+PrepareResult DB::compile_plan(std::string &shape, Plan &plan)
 {
-    for (uint32_t i = 0; i < level; i++)
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    while (start <= shape.size())
     {
-        std::cout << "  ";
+        size_t end = std::min(shape.find(' ', start), shape.size());
+        tokens.push_back(shape.substr(start, end - start));
+        start = end + 1;
     }
-}
-void Pager::print_tree(uint32_t page_num, uint32_t indentation_level)
-{
-    Node *node = new Node(get_page(page_num));
-    uint32_t num_keys, child;
-
-    switch (node->get_node_type())
+    uint32_t num_params = 0;
+    for (std::string &token : tokens)
     {
-    case (NODE_LEAF):
-        num_keys = *((LeafNode *)node)->leaf_node_num_cells();
-        indent(indentation_level);
-        std::cout << "- leaf (size " << num_keys << ")" << std::endl;
-        for (uint32_t i = 0; i < num_keys; i++)
-        {
-            indent(indentation_level + 1);
-            std::cout << "- " << *((LeafNode *)node)->leaf_node_key(i) << std::endl;
-        }
-        break;
-    case (NODE_INTERNAL):
-        num_keys = *((InternalNode *)node)->internal_node_num_keys();
-        indent(indentation_level);
-        std::cout << "- internal (size " << num_keys << ")" << std::endl;
-        for (uint32_t i = 0; i < num_keys; i++)
-        {
-            child = *((InternalNode *)node)->internal_node_child(i);
-            print_tree(child, indentation_level + 1);
-
-            indent(indentation_level + 1);
-            std::cout << "- key " << *((InternalNode *)node)->internal_node_key(i) << std::endl;
-        }
-        child = *((InternalNode *)node)->internal_node_right_child();
-        print_tree(child, indentation_level + 1);
-        break;
+        num_params += token == "?";
     }
-    delete node;
-}
-/*
-Until we start recycling free pages, new pages will always
-go onto the end of the database file
-*/
-uint32_t Pager::get_unused_page_num()
-{
-    return num_pages;
-}
-
-class Table;
-
-class Cursor
-{
-private:
-    Table *table;
-    uint32_t page_num;
-    uint32_t cell_num;
-    bool end_of_table;
-
-public:
-    Cursor(Table *table);
-    Cursor(Table *table, uint32_t page_num, uint32_t cell_num);
-    void *cursor_value();
-    void cursor_advance();
-    void leaf_node_insert(uint32_t key, Row &value);
-    void leaf_node_split_and_insert(uint32_t key, Row &value);
-    void internal_node_insert(uint32_t key, uint32_t right_child);
-    ~Cursor();
-
-    friend class DB;
-};
-
-class Table
-{
-private:
-    uint32_t root_page_num;
-    Pager pager;
 
-public:
-    Table(const char *filename) : pager(filename)
+    if (tokens[0] == "insert")
     {
-        root_page_num = 0;
-        if (pager.num_pages == 0)
+        if (num_params < 3)
         {
-            // New file. Initialize page 0 as leaf node.
-            LeafNode root_node = pager.get_page(0);
-            root_node.initialize_leaf_node();
-            root_node.set_node_root(true);
+            return PREPARE_SYNTAX_ERROR;
         }
+        plan = Plan(STATEMENT_INSERT, num_params);
+        return PREPARE_SUCCESS;
     }
-    Cursor *table_find(uint32_t key);
-    Cursor *internal_node_find(uint32_t key, uint32_t page_num);
-    void create_new_root(uint32_t right_child_page_num);
-    ~Table();
-
-    friend class Cursor;
-    friend class DB;
-};
-
-Cursor::Cursor(Table *table)
-{
-    Cursor *cursor = table->table_find(0);
-    this->table = table;
-    this->page_num = cursor->page_num;
-    this->cell_num = cursor->cell_num;
-
-    LeafNode root_node = table->pager.get_page(cursor->page_num);
-    uint32_t num_cells = *root_node.leaf_node_num_cells();
-
-    this->end_of_table = (num_cells == 0);
-}
-Cursor::Cursor(Table *table, uint32_t page_num, uint32_t key)
-{
-    this->table = table;
-    this->page_num = page_num;
-    this->end_of_table = false;
-
-    LeafNode root_node = table->pager.get_page(page_num);
-    uint32_t num_cells = *root_node.leaf_node_num_cells();
-
-    // Binary search
-    uint32_t min_index = 0;
-    uint32_t one_past_max_index = num_cells;
-    while (one_past_max_index != min_index)
-    {
-        uint32_t index = (min_index + one_past_max_index) / 2;
-        uint32_t key_at_index = *root_node.leaf_node_key(index);
-        if (key == key_at_index)
-        {
-            this->cell_num = index;
-            return;
-        }
-        if (key < key_at_index)
-        {
-            one_past_max_index = index;
-        }
-        else
-        {
-            min_index = index + 1;
-        }
+    else if (tokens[0] == "select")
+    {
+        plan = Plan(STATEMENT_SELECT, num_params);
+        return compile_select(tokens, plan);
     }
-
-    this->cell_num = min_index;
-}
-void *Cursor::cursor_value()
-{
-    void *page = table->pager.get_page(page_num);
-
-    return LeafNode(page).leaf_node_value(cell_num);
-}
-void Cursor::cursor_advance()
-{
-    LeafNode leaf_node = table->pager.get_page(page_num);
-    cell_num += 1;
-    if (cell_num >= *leaf_node.leaf_node_num_cells())
+    else if (tokens[0] == "create")
     {
-        /* Advance to next leaf node */
-        uint32_t next_page_num = *leaf_node.leaf_node_next_leaf();
-        if (next_page_num == 0)
-        {
-            /* This was rightmost leaf */
-            end_of_table = true;
-        }
-        else
-        {
-            page_num = next_page_num;
-            cell_num = 0;
-        }
+        plan = Plan(STATEMENT_CREATE_INDEX, num_params);
+        return compile_create_index(tokens, plan);
     }
-}
-void Cursor::internal_node_insert(uint32_t parent_page_num, uint32_t child_page_num)
-{
-    /*
-    Add a new child/key pair to parent that corresponds to child
-    */
-
-    InternalNode parent = table->pager.get_page(parent_page_num);
-    Node child = table->pager.get_page(child_page_num);
-    uint32_t child_max_key = child.get_node_max_key();
-    uint32_t index = parent.internal_node_find_child(child_max_key);
-
-    uint32_t original_num_keys = *parent.internal_node_num_keys();
-    *parent.internal_node_num_keys() = original_num_keys + 1;
-
-    if (original_num_keys >= INTERNAL_NODE_MAX_CELLS)
+    else if (shape == "begin")
     {
-        std::cout << "Need to implement splitting internal node" << std::endl;
-        exit(EXIT_FAILURE);
+        plan = Plan(STATEMENT_BEGIN, num_params);
+        return PREPARE_SUCCESS;
     }
-
-    uint32_t right_child_page_num = *parent.internal_node_right_child();
-    Node right_child = table->pager.get_page(right_child_page_num);
-
-    if (child_max_key > right_child.get_node_max_key())
+    else if (shape == "commit")
     {
-        /* Replace right child */
-        *parent.internal_node_child(original_num_keys) = right_child_page_num;
-        *parent.internal_node_key(original_num_keys) =
-            right_child.get_node_max_key();
-        *parent.internal_node_right_child() = child_page_num;
+        plan = Plan(STATEMENT_COMMIT, num_params);
+        return PREPARE_SUCCESS;
+    }
+    else if (shape == "rollback")
+    {
+        plan = Plan(STATEMENT_ROLLBACK, num_params);
+        return PREPARE_SUCCESS;
     }
     else
     {
-        /* Make room for the new cell */
-        for (uint32_t i = original_num_keys; i > index; i--)
-        {
-            void *destination = parent.internal_node_cell(i);
-            void *source = parent.internal_node_cell(i - 1);
-            memcpy(destination, source, INTERNAL_NODE_CELL_SIZE);
-        }
-        *parent.internal_node_child(index) = child_page_num;
-        *parent.internal_node_key(index) = child_max_key;
+        return PREPARE_UNRECOGNIZED_STATEMENT;
     }
 }
-void Cursor::leaf_node_insert(uint32_t key, Row &value)
+PrepareResult DB::compile_select(std::vector<std::string> &tokens, Plan &plan)
 {
-    LeafNode leaf_node = table->pager.get_page(page_num);
-    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
-
-    if (num_cells >= LEAF_NODE_MAX_CELLS)
+    /* The aggregates run up to the first clause, spaces after commas or not */
+    size_t i = 1;
+    std::string aggregates;
+    while (i < tokens.size() && tokens[i] != "where" && tokens[i] != "limit" && tokens[i] != "offset")
     {
-        // Node full
-        leaf_node_split_and_insert(key, value);
-        return;
+        aggregates += tokens[i++];
     }
-
-    if (cell_num < num_cells)
+    size_t start = 0;
+    while (!aggregates.empty() && start <= aggregates.size())
     {
-        // make room for new cell
-        for (uint32_t i = num_cells; i > cell_num; i--)
+        size_t end = std::min(aggregates.find(',', start), aggregates.size());
+        if (!parse_aggregate(aggregates.substr(start, end - start), plan.aggregates))
         {
-            memcpy(leaf_node.leaf_node_cell(i), leaf_node.leaf_node_cell(i - 1),
-                   LEAF_NODE_CELL_SIZE);
+            return PREPARE_SYNTAX_ERROR;
         }
+        start = end + 1;
     }
 
-    // insert new cell
-    *leaf_node.leaf_node_num_cells() += 1;
-    *leaf_node.leaf_node_key(cell_num) = key;
-    serialize_row(value, leaf_node.leaf_node_value(cell_num));
-}
-void Cursor::leaf_node_split_and_insert(uint32_t key, Row &value)
-{
-    /*
-    Create a new node and move half the cells over.
-    Insert the new value in one of the two nodes.
-    Update parent or create a new parent.
-    */
-
-    LeafNode old_node = table->pager.get_page(page_num);
-    uint32_t old_max = old_node.get_node_max_key();
-
-    uint32_t new_page_num = table->pager.get_unused_page_num();
-    LeafNode new_node = table->pager.get_page(new_page_num);
-    new_node.initialize_leaf_node();
-
-    *new_node.node_parent() = *old_node.node_parent();
-
-    *new_node.leaf_node_next_leaf() = *old_node.leaf_node_next_leaf();
-    *old_node.leaf_node_next_leaf() = new_page_num;
-
-    /*
-    All existing keys plus new key should be divided
-    evenly between old (left) and new (right) nodes.
-    Starting from the right, move each key to correct position.
-    */
-    for (int32_t i = LEAF_NODE_MAX_CELLS; i >= 0; i--)
+    uint32_t param = 0;
+    if (i < tokens.size() && tokens[i] == "where")
     {
-        LeafNode destination_node;
-        if (i >= LEAF_NODE_LEFT_SPLIT_COUNT)
+        if (i + 3 >= tokens.size() || !parse_column(tokens[i + 1], plan.where_column) || tokens[i + 3] != "?")
+        {
+            return PREPARE_SYNTAX_ERROR;
+        }
+        plan.where = true;
+        plan.where_param = param++;
+        if (tokens[i + 2] == "=")
         {
-            destination_node = new_node;
+            plan.where_prefix = false;
+        }
+        else if (tokens[i + 2] == "like" && plan.where_column != COLUMN_ID)
+        {
+            // Only prefix patterns, checked when the pattern is bound
+            plan.where_prefix = true;
         }
         else
         {
-            destination_node = old_node;
+            return PREPARE_SYNTAX_ERROR;
         }
-        uint32_t index_within_node = i % LEAF_NODE_LEFT_SPLIT_COUNT;
-        LeafNode destination = destination_node.leaf_node_cell(index_within_node);
-
-        if (i == cell_num)
+        i += 4;
+    }
+    for (; i < tokens.size(); i += 2)
+    {
+        if (i + 1 >= tokens.size() || tokens[i + 1] != "?")
         {
-            serialize_row(value,
-                          destination_node.leaf_node_value(index_within_node));
-            *destination_node.leaf_node_key(index_within_node) = key;
+            return PREPARE_SYNTAX_ERROR;
         }
-        else if (i > cell_num)
+        if (tokens[i] == "limit")
         {
-            memcpy(destination.get_node(), old_node.leaf_node_cell(i - 1), LEAF_NODE_CELL_SIZE);
+            plan.limit_param = param++;
+        }
+        else if (tokens[i] == "offset")
+        {
+            plan.offset_param = param++;
         }
         else
         {
-            memcpy(destination.get_node(), old_node.leaf_node_cell(i), LEAF_NODE_CELL_SIZE);
+            return PREPARE_SYNTAX_ERROR;
         }
     }
-    /* Update cell count on both leaf nodes */
-    *old_node.leaf_node_num_cells() = LEAF_NODE_LEFT_SPLIT_COUNT;
-    *new_node.leaf_node_num_cells() = LEAF_NODE_RIGHT_SPLIT_COUNT;
-
-    if (old_node.is_node_root())
-    {
-        return table->create_new_root(new_page_num);
-    }
-    else
+    if (!plan.aggregates.empty() && (plan.limit_param != PLAN_NO_PARAM || plan.offset_param != PLAN_NO_PARAM))
     {
-        uint32_t parent_page_num = *old_node.node_parent();
-        uint32_t new_max = old_node.get_node_max_key();
-        InternalNode parent = table->pager.get_page(parent_page_num);
-        parent.update_internal_node_key(old_max, new_max);
-        internal_node_insert(parent_page_num, new_page_num);
-        return;
-    }
-}
-Cursor::~Cursor()
-{
-    //delete table;
-}
-Cursor *Table::internal_node_find(uint32_t page_num, uint32_t key)
-{
-    InternalNode node = pager.get_page(page_num);
-
-    uint32_t child_index = node.internal_node_find_child(key);
-    uint32_t child_num = *node.internal_node_child(child_index);
-    Node child = pager.get_page(child_num);
-    switch (child.get_node_type())
-    {
-    case NODE_INTERNAL:
-        return internal_node_find(child_num, key);
-    case NODE_LEAF:
-    default:
-        return new Cursor(this, child_num, key);
+        // Aggregates take no limit or offset
+        return PREPARE_SYNTAX_ERROR;
     }
+    return PREPARE_SUCCESS;
 }
-Cursor *Table::table_find(uint32_t key)
+PrepareResult DB::compile_create_index(std::vector<std::string> &tokens, Plan &plan)
 {
-    Node root_node = pager.get_page(root_page_num);
-
-    if (root_node.get_node_type() == NODE_LEAF)
+    /* The table is always called users */
+    if (tokens.size() != 4 || tokens[1] != "index" || tokens[2] != "on")
     {
-        return new Cursor(this, root_page_num, key);
+        return PREPARE_SYNTAX_ERROR;
     }
-    else
+    const std::string &target = tokens[3];
+    if (target.compare(0, 6, "users(") || target.back() != ')' ||
+        !parse_column(target.substr(6, target.size() - 7), plan.index_column))
     {
-        return internal_node_find(root_page_num, key);
+        return PREPARE_SYNTAX_ERROR;
     }
+    return PREPARE_SUCCESS;
 }
-void Table::create_new_root(uint32_t right_child_page_num)
-{
-    /*
-    Handle splitting the root.
-    Old root copied to new page, becomes left child.
-    Address of right child passed in.
-    Re-initialize root page to contain the new root node.
-    New root node points to two children.
-    */
-
-    InternalNode root = pager.get_page(root_page_num);
-    Node right_child = pager.get_page(right_child_page_num);
-    uint32_t left_child_page_num = pager.get_unused_page_num();
-    Node left_child = pager.get_page(left_child_page_num);
-
-    /* Left child has data copied from old root */
-    memcpy(left_child.get_node(), root.get_node(), PAGE_SIZE);
-    left_child.set_node_root(false);
-
-    /* Root node is a new internal node with one key and two children */
-    root.initialize_internal_node();
-    root.set_node_root(true);
-    *root.internal_node_num_keys() = 1;
-    *root.internal_node_child(0) = left_child_page_num;
-    uint32_t left_child_max_key = left_child.get_node_max_key();
-    *root.internal_node_key(0) = left_child_max_key;
-    *root.internal_node_right_child() = right_child_page_num;
-
-    *left_child.node_parent() = root_page_num;
-    *right_child.node_parent() = root_page_num;
-}
-Table::~Table()
+static bool parse_id(const std::string &param, uint64_t &id)
 {
-    for (uint32_t i = 0; i < pager.num_pages; i++)
+    /* Ids are 64-bit, too large for atoi */
+    if (param.empty() || param.find_first_not_of("0123456789") != std::string::npos)
     {
-        if (pager.pages[i] == nullptr)
-        {
-            continue;
-        }
-        pager.pager_flush(i);
-        free(pager.pages[i]);
-        pager.pages[i] = nullptr;
+        return false;
     }
+    errno = 0;
+    id = strtoull(param.c_str(), nullptr, 10);
+    return errno != ERANGE;
+}
+PrepareResult DB::bind_insert(std::vector<std::string> &params, Statement &statement)
+{
+    const char *id_string = params[0].c_str();
+    const char *username = params[1].c_str();
+    const char *email = params[2].c_str();
 
-    int result = close(pager.file_descriptor);
-    if (result == -1)
+    if (id_string[0] == '-')
     {
-        std::cout << "Error closing db file." << std::endl;
-        exit(EXIT_FAILURE);
+        return PREPARE_NEGATIVE_ID;
     }
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    uint64_t id;
+    if (!parse_id(params[0], id))
     {
-        void *page = pager.pages[i];
-        if (page)
-        {
-            free(page);
-            pager.pages[i] = nullptr;
-        }
+        return PREPARE_SYNTAX_ERROR;
     }
-}
-
-class Statement
-{
-public:
-    StatementType type;
-    Row row_to_insert;
-};
-class DB
-{
-private:
-    Table *table;
-
-public:
-    DB(const char *filename)
+    if (strlen(username) > COLUMN_USERNAME_SIZE)
     {
-        table = new Table(filename);
+        return PREPARE_STRING_TOO_LONG;
     }
-    void start();
-    void print_prompt();
-
-    bool parse_meta_command(std::string &command);
-    MetaCommandResult do_meta_command(std::string &command);
-
-    PrepareResult prepare_insert(std::string &input_line, Statement &statement);
-    PrepareResult prepare_statement(std::string &input_line, Statement &statement);
-    bool parse_statement(std::string &input_line, Statement &statement);
-    void execute_statement(Statement &statement);
-    ExecuteResult execute_insert(Statement &statement);
-    ExecuteResult execute_select(Statement &statement);
-
-    ~DB()
+    if (strlen(email) > COLUMN_EMAIL_SIZE)
     {
-        delete table;
+        return PREPARE_STRING_TOO_LONG;
     }
-};
-
-void DB::print_prompt()
-{
-    std::cout << "db > ";
-}
+    statement.row_to_insert = Row(id, username, email);
 
-bool DB::parse_meta_command(std::string &command)
-{
-    if (command[0] == '.')
-    {
-        switch (do_meta_command(command))
-        {
-        case META_COMMAND_SUCCESS:
-            return true;
-        case META_COMMAND_UNRECOGNIZED_COMMAND:
-            std::cout << "Unrecognized command: " << command << std::endl;
-            return true;
-        }
-    }
-    return false;
+    return PREPARE_SUCCESS;
 }
-MetaCommandResult DB::do_meta_command(std::string &command)
+static bool parse_count(const std::string &param, uint32_t &count)
 {
-    if (command == ".exit")
+    if (param.empty() || param.find_first_not_of("0123456789") != std::string::npos)
     {
-        delete (table);
-        std::cout << "Bye!" << std::endl;
-        exit(EXIT_SUCCESS);
-    }
-    else if (command == ".btree")
-    {
-        std::cout << "Tree:" << std::endl;
-        Node root_node = table->pager.get_page(table->root_page_num);
-        table->pager.print_tree(0, 0);
-        return META_COMMAND_SUCCESS;
-    }
-    else if (command == ".constants")
-    {
-        std::cout << "Constants:" << std::endl;
-        std::cout << "ROW_SIZE: " << ROW_SIZE << std::endl;
-        std::cout << "COMMON_NODE_HEADER_SIZE: " << COMMON_NODE_HEADER_SIZE << std::endl;
-        std::cout << "LEAF_NODE_HEADER_SIZE: " << LEAF_NODE_HEADER_SIZE << std::endl;
-        std::cout << "LEAF_NODE_CELL_SIZE: " << LEAF_NODE_CELL_SIZE << std::endl;
-        std::cout << "LEAF_NODE_SPACE_FOR_CELLS: " << LEAF_NODE_SPACE_FOR_CELLS << std::endl;
-        std::cout << "LEAF_NODE_MAX_CELLS: " << LEAF_NODE_MAX_CELLS << std::endl;
-        return META_COMMAND_SUCCESS;
+        return false;
     }
-    else
+    errno = 0;
+    uint64_t value = strtoull(param.c_str(), nullptr, 10);
+    if (errno == ERANGE || value > UINT32_MAX)
     {
-        return META_COMMAND_UNRECOGNIZED_COMMAND;
+        return false;
     }
+    count = value;
+    return true;
 }
-
-PrepareResult DB::prepare_insert(std::string &input_line, Statement &statement)
+PrepareResult DB::bind_select(Plan &plan, std::vector<std::string> &params, Statement &statement)
 {
-    statement.type = STATEMENT_INSERT;
+    statement.select_aggregates = plan.aggregates;
+    statement.select_where = plan.where;
+    statement.where_column = plan.where_column;
+    statement.where_prefix = plan.where_prefix;
+    statement.select_limit = UINT32_MAX;
+    statement.select_offset = 0;
 
-    char *insert_line = (char *)input_line.c_str();
-    char *keyword = strtok(insert_line, " ");
-    char *id_string = strtok(NULL, " ");
-    char *username = strtok(NULL, " ");
-    char *email = strtok(NULL, " ");
-
-    if (id_string == NULL || username == NULL || email == NULL)
+    if (plan.where)
     {
-        return PREPARE_SYNTAX_ERROR;
-    }
-    int id = atoi(id_string);
-    if (id < 0)
-    {
-        return PREPARE_NEGATIVE_ID;
+        statement.where_value = params[plan.where_param];
+        uint64_t id;
+        if (plan.where_prefix)
+        {
+            if (statement.where_value.find('%') != statement.where_value.size() - 1)
+            {
+                return PREPARE_SYNTAX_ERROR;
+            }
+            statement.where_value.pop_back();
+        }
+        else if (plan.where_column == COLUMN_ID && !parse_id(statement.where_value, id))
+        {
+            return PREPARE_SYNTAX_ERROR;
+        }
     }
-    if (strlen(username) > COLUMN_USERNAME_SIZE)
+    if (plan.limit_param != PLAN_NO_PARAM && !parse_count(params[plan.limit_param], statement.select_limit))
     {
-        return PREPARE_STRING_TOO_LONG;
+        return PREPARE_SYNTAX_ERROR;
     }
-    if (strlen(email) > COLUMN_EMAIL_SIZE)
+    if (plan.offset_param != PLAN_NO_PARAM && !parse_count(params[plan.offset_param], statement.select_offset))
     {
-        return PREPARE_STRING_TOO_LONG;
+        return PREPARE_SYNTAX_ERROR;
     }
-    statement.row_to_insert = Row(id, username, email);
-
     return PREPARE_SUCCESS;
 }
 PrepareResult DB::prepare_statement(std::string &input_line, Statement &statement)
 {
-    if (!input_line.compare(0, 6, "insert"))
+    std::string shape;
+    std::vector<std::string> params;
+    normalize_statement(input_line, shape, params);
+
+    Plan *plan = plan_cache.lookup(shape);
+    if (plan == nullptr)
     {
-        return prepare_insert(input_line, statement);
+        Plan compiled;
+        PrepareResult result = compile_plan(shape, compiled);
+        if (result != PREPARE_SUCCESS)
+        {
+            return result;
+        }
+        plan = plan_cache.insert(shape, compiled);
     }
-    else if (!input_line.compare(0, 6, "select"))
+
+    statement.type = plan->type;
+    switch (plan->type)
     {
-        statement.type = STATEMENT_SELECT;
+    case STATEMENT_INSERT:
+        return bind_insert(params, statement);
+    case STATEMENT_SELECT:
+        return bind_select(*plan, params, statement);
+    case STATEMENT_CREATE_INDEX:
+        statement.index_column = plan->index_column;
+        return PREPARE_SUCCESS;
+    default:
         return PREPARE_SUCCESS;
     }
-    else
-    {
-        return PREPARE_UNRECOGNIZED_STATEMENT;
-    }
+    return PREPARE_SUCCESS;
 }
 bool DB::parse_statement(std::string &input_line, Statement &statement)
 {
@@ -996,42 +645,84 @@ bool DB::parse_statement(std::string &input_line, Statement &statement)
 }
 ExecuteResult DB::execute_insert(Statement &statement)
 {
-    LeafNode leaf_node = table->pager.get_page(table->root_page_num);
-    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
-
-    Cursor *cursor = table->table_find(statement.row_to_insert.id);
-
-    if (cursor->cell_num < num_cells)
+    return database->insert(statement.row_to_insert, transaction);
+}
+ExecuteResult DB::execute_select(Statement &statement)
+{
+    if (!statement.select_aggregates.empty())
     {
-        uint32_t key_at_index = *leaf_node.leaf_node_key(cursor->cell_num);
-        if (key_at_index == statement.row_to_insert.id)
+        StringFilter filter = {statement.where_column, statement.where_value.c_str(), statement.where_prefix};
+        database->aggregate(statement.select_aggregates, statement.select_where ? &filter : nullptr, transaction);
+        std::cout << "(";
+        for (size_t i = 0; i < statement.select_aggregates.size(); i++)
         {
-            return EXECUTE_DUPLICATE_KEY;
+            std::cout << (i > 0 ? ", " : "") << statement.select_aggregates[i].result();
         }
-    }
-    cursor->leaf_node_insert(statement.row_to_insert.id, statement.row_to_insert);
-
-    delete cursor;
+        std::cout << ")" << std::endl;
+        return EXECUTE_SUCCESS;
+    }
+    auto print_row = [](const RowView &row)
+    { std::cout << "(" << row.id() << ", " << row.username() << ", " << row.email() << ")" << std::endl; };
+    if (!statement.select_where)
+    {
+        database->scan_views(statement.select_offset, statement.select_limit, print_row, transaction);
+        return EXECUTE_SUCCESS;
+    }
+
+    uint32_t skipped = 0, printed = 0;
+    database->find(statement.where_column, statement.where_value.c_str(), statement.where_prefix,
+                   [&](Row &row)
+                   {
+                       if (skipped < statement.select_offset)
+                       {
+                           skipped++;
+                       }
+                       else if (printed < statement.select_limit)
+                       {
+                           printed++;
+                           print_row(row);
+                       }
+                   },
+                   transaction);
 
     return EXECUTE_SUCCESS;
 }
-ExecuteResult DB::execute_select(Statement &statement)
+ExecuteResult DB::execute_transaction(Statement &statement)
 {
-    // start of the table
-    Cursor *cursor = new Cursor(table);
-
-    Row row;
-    while (!cursor->end_of_table)
+    if (statement.type == STATEMENT_BEGIN)
     {
-        deserialize_row(cursor->cursor_value(), row);
-        std::cout << "(" << row.id << ", " << row.username << ", " << row.email << ")" << std::endl;
-        cursor->cursor_advance();
+        if (transaction != nullptr)
+        {
+            return EXECUTE_TRANSACTION_OPEN;
+        }
+        transaction = database->begin_transaction();
+        return EXECUTE_SUCCESS;
     }
 
-    delete cursor;
-
+    if (transaction == nullptr)
+    {
+        return EXECUTE_NO_TRANSACTION;
+    }
+    if (statement.type == STATEMENT_COMMIT)
+    {
+        database->commit(transaction);
+    }
+    else
+    {
+        database->rollback(transaction);
+    }
+    transaction = nullptr;
     return EXECUTE_SUCCESS;
 }
+ExecuteResult DB::execute_create_index(Statement &statement)
+{
+    /* Building the index waits for every writer, including our own transaction */
+    if (transaction != nullptr)
+    {
+        return EXECUTE_TRANSACTION_OPEN;
+    }
+    return database->create_index(statement.index_column);
+}
 void DB::execute_statement(Statement &statement)
 {
     ExecuteResult result;
@@ -1043,6 +734,14 @@ void DB::execute_statement(Statement &statement)
     case STATEMENT_SELECT:
         result = execute_select(statement);
         break;
+    case STATEMENT_BEGIN:
+    case STATEMENT_COMMIT:
+    case STATEMENT_ROLLBACK:
+        result = execute_transaction(statement);
+        break;
+    case STATEMENT_CREATE_INDEX:
+        result = execute_create_index(statement);
+        break;
     }
 
     switch (result)
@@ -1056,6 +755,15 @@ void DB::execute_statement(Statement &statement)
     case EXECUTE_TABLE_FULL:
         std::cout << "Error: Table full." << std::endl;
         break;
+    case EXECUTE_TRANSACTION_OPEN:
+        std::cout << "Error: Transaction already open." << std::endl;
+        break;
+    case EXECUTE_NO_TRANSACTION:
+        std::cout << "Error: No transaction open." << std::endl;
+        break;
+    case EXECUTE_INDEX_EXISTS:
+        std::cout << "Error: Index already exists." << std::endl;
+        break;
     }
 }
 
@@ -1092,7 +800,60 @@ int main(int argc, char const *argv[])
         exit(EXIT_FAILURE);
     }
 
-    DB db(argv[1]);
+    const char *socket_path = nullptr;
+    uint32_t page_size = DEFAULT_PAGE_SIZE;
+    LeafLayout layout = LEAF_LAYOUT_ROWS;
+    PageCompression compression = PAGE_COMPRESSION_NONE;
+    for (int i = 2; i < argc; i += 2)
+    {
+        if (i + 1 < argc && !strcmp(argv[i], "--serve"))
+        {
+            socket_path = argv[i + 1];
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--page-size"))
+        {
+            page_size = atoi(argv[i + 1]);
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--layout") && !strcmp(argv[i + 1], "rows"))
+        {
+            layout = LEAF_LAYOUT_ROWS;
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--layout") && !strcmp(argv[i + 1], "pax"))
+        {
+            layout = LEAF_LAYOUT_PAX;
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--layout") && !strcmp(argv[i + 1], "dict"))
+        {
+            layout = LEAF_LAYOUT_DICT;
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--compression") && !strcmp(argv[i + 1], "none"))
+        {
+            compression = PAGE_COMPRESSION_NONE;
+        }
+        else if (i + 1 < argc && !strcmp(argv[i], "--compression") && !strcmp(argv[i + 1], "lz"))
+        {
+            compression = PAGE_COMPRESSION_LZ;
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " <database> [--page-size <bytes>] [--layout rows|pax|dict]"
+                      << " [--compression none|lz] [--serve <socket>]"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (socket_path != nullptr)
+    {
+        Database *database = Database::open(argv[1], page_size, layout, compression);
+        Server *server = new Server(database, socket_path);
+        server->run();
+        delete server;
+        delete database;
+        return 0;
+    }
+
+    DB db(argv[1], page_size, layout, compression);
     db.start();
     return 0;
 }
@@ -1,6 +1,8 @@
+require "socket"
+
 describe "database" do
   before do
-    `rm -rf test.db`
+    `rm -rf test.db test.db-wal`
   end
 
   def run_script(commands)
@@ -22,6 +24,56 @@ describe "database" do
     raw_output.split("\n")
   end
 
+  def crash_script(commands, idle = 0)
+    IO.popen("./db test.db", "r+") do |pipe|
+      commands.each do |command|
+        pipe.puts command
+        pipe.gets
+      end
+      sleep idle
+      Process.kill("KILL", pipe.pid)
+    end
+  end
+
+  def frame(body)
+    [body.bytesize].pack("L") + body
+  end
+
+  def encode_row(id, username, email)
+    [id, username.bytesize].pack("QC") + username + [email.bytesize].pack("C") + email
+  end
+
+  def decode_row(body)
+    id, username_length = body.unpack("QC")
+    username = body[9, username_length]
+    email_length = body[9 + username_length].ord
+    email = body[10 + username_length, email_length]
+    [[id, username, email], body[(10 + username_length + email_length)..]]
+  end
+
+  def run_server(requests)
+    `rm -f test.sock`
+    pid = spawn("./db test.db --serve test.sock")
+    sleep 0.01 until File.exist?("test.sock")
+    raw_responses = nil
+    UNIXSocket.open("test.sock") do |socket|
+      # Send every request in a single write and only then read the answers
+      socket.write(requests.map { |request| frame(request) }.join)
+      socket.close_write
+      raw_responses = socket.read
+    end
+    Process.kill("TERM", pid)
+    Process.wait(pid)
+
+    responses = []
+    until raw_responses.empty?
+      length = raw_responses.unpack1("L")
+      responses << raw_responses[4, length]
+      raw_responses = raw_responses[(4 + length)..]
+    end
+    responses
+  end
+
   it "test exit and unrecognized command and sql sentence" do
     result = run_script([
       "hello world",
@@ -110,6 +162,38 @@ describe "database" do
     ])
   end
 
+  it "accepts 64-bit ids" do
+    script = [
+      "insert 18446744073709551615 max max@example.com",
+      "insert 4294967296 big big@example.com",
+      "insert 1 small small@example.com",
+      "insert 18446744073709551616 over over@example.com",
+      "insert 12abc bad bad@example.com",
+      "select",
+      "select where id = 4294967296",
+      "select where id = 12abc",
+      "select where id = 18446744073709551616",
+      ".exit",
+    ]
+    result = run_script(script)
+    expect(result).to match_array([
+      "db > Executed.",
+      "db > Executed.",
+      "db > Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > (1, small, small@example.com)",
+      "(4294967296, big, big@example.com)",
+      "(18446744073709551615, max, max@example.com)",
+      "Executed.",
+      "db > (4294967296, big, big@example.com)",
+      "Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Bye!",
+    ])
+  end
+
   it "keeps data after closing connection" do
     result1 = run_script([
       "insert 1 user1 person1@example.com",
@@ -159,11 +243,12 @@ describe "database" do
 
     expect(result).to match_array([
                         "db > Constants:",
-                        "ROW_SIZE: 293",
-                        "COMMON_NODE_HEADER_SIZE: \u0006",
-                        "LEAF_NODE_HEADER_SIZE: 14",
-                        "LEAF_NODE_CELL_SIZE: 297",
-                        "LEAF_NODE_SPACE_FOR_CELLS: 4082",
+                        "PAGE_SIZE: 4096",
+                        "ROW_SIZE: 297",
+                        "COMMON_NODE_HEADER_SIZE: 23",
+                        "LEAF_NODE_HEADER_SIZE: 31",
+                        "LEAF_NODE_CELL_SIZE: 305",
+                        "LEAF_NODE_SPACE_FOR_CELLS: 4065",
                         "LEAF_NODE_MAX_CELLS: 13",
                         "db > Bye!",
                       ])
@@ -268,6 +353,102 @@ describe "database" do
     ])
   end
 
+  it "counts rows and seeks to an offset in a multi-level tree" do
+    script = (1..30).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script << ".exit"
+    run_script(script)
+
+    result = run_script([
+      "select count(*)",
+      "select offset 12 limit 3",
+      "select limit 2 offset 28",
+      "select offset 30",
+      "select offset x1",
+      "select limit 4294967296",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > (30)",
+      "Executed.",
+      "db > (13, user13, person13@example.com)",
+      "(14, user14, person14@example.com)",
+      "(15, user15, person15@example.com)",
+      "Executed.",
+      "db > (29, user29, person29@example.com)",
+      "(30, user30, person30@example.com)",
+      "Executed.",
+      "db > Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Bye!",
+    ])
+  end
+
+  it "computes aggregates over the whole table and over filtered rows" do
+    script = (1..30).map { |i| (i * 7) % 31 }.map do |i|
+      "insert #{i} user#{i % 3} person#{i}@example.com"
+    end
+    script += [
+      "select min(id), max(id)",
+      "select count(*), min(id), max(id), sum(id)",
+      "select count(*),max(email) where username = user1",
+      "select min(username), sum(id) where email like person2%",
+      "select min(id), count(email) where username = nobody",
+      "select max(username) where id = 17",
+      "create index on users(username)",
+      "select count(*), sum(id) where username = user1",
+      "select count(*) limit 1",
+      "select sum(email)",
+      ".exit",
+    ]
+    result = run_script(script)
+    expect(result.last(18)).to match_array([
+      "db > (1, 30)",
+      "Executed.",
+      "db > (30, 1, 30, 465)",
+      "Executed.",
+      "db > (10, person7@example.com)",
+      "Executed.",
+      "db > (user0, 247)",
+      "Executed.",
+      "db > (NULL, 0)",
+      "Executed.",
+      "db > (user2)",
+      "Executed.",
+      "db > Executed.",
+      "db > (10, 145)",
+      "Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Bye!",
+    ])
+  end
+
+  it "counts the rows of an open transaction only inside it" do
+    result = run_script([
+      "insert 1 user1 person1@example.com",
+      "begin",
+      "insert 2 user2 person2@example.com",
+      "select count(*)",
+      "rollback",
+      "select count(*)",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > Executed.",
+      "db > Executed.",
+      "db > Executed.",
+      "db > (2)",
+      "Executed.",
+      "db > Executed.",
+      "db > (1)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
   it "allows printing out the structure of a 4-leaf-node btree" do
     script = [
       "insert 18 user18 person18@example.com",
@@ -348,4 +529,451 @@ describe "database" do
       "db > Bye!",
     ])
   end
+  it "reuses cached plans for statements that only differ in literals" do
+    script = [
+      "insert 1 user1 person1@example.com",
+      "insert 2 user2 person2@example.com",
+      "insert 3 user3",
+      "select",
+      "select",
+      "select where username = user1 limit 5",
+      "select where username = user2 limit 1",
+      "select where email = user2 limit 1",
+      "select where username = user2 limit x",
+      ".plancache",
+      ".exit",
+    ]
+    result = run_script(script)
+    expect(result).to match_array([
+      "db > Executed.",
+      "db > Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > (1, user1, person1@example.com)",
+      "(2, user2, person2@example.com)",
+      "Executed.",
+      "db > (1, user1, person1@example.com)",
+      "(2, user2, person2@example.com)",
+      "Executed.",
+      "db > (1, user1, person1@example.com)",
+      "Executed.",
+      "db > (2, user2, person2@example.com)",
+      "Executed.",
+      "db > Executed.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Plan cache:",
+      "capacity: 64",
+      "size: 4",
+      "hits: 4",
+      "misses: 5",
+      "evictions: 0",
+      "db > Bye!",
+    ])
+  end
+
+  it "evicts the least recently used plan when the cache is full" do
+    script = (0..64).map do |i|
+      "select" + " limit 1" * i
+    end
+    script << "select"
+    script << ".plancache"
+    script << ".exit"
+    result = run_script(script)
+    expect(result.last(7)).to match_array([
+      "db > Plan cache:",
+      "capacity: 64",
+      "size: 64",
+      "hits: 0",
+      "misses: 66",
+      "evictions: 2",
+      "db > Bye!",
+    ])
+  end
+  it "answers pipelined requests over a unix socket" do
+    responses = run_server([
+      [1].pack("C") + encode_row(2, "user2", "person2@example.com"),
+      [1].pack("C") + encode_row(1, "user1", "person1@example.com"),
+      [1].pack("C") + encode_row(1, "user1", "person1@example.com"),
+      [2, 2].pack("CQ"),
+      [2, 9].pack("CQ"),
+      [3].pack("C"),
+      [7].pack("C"),
+    ])
+    expect(responses.length).to eq(7)
+    expect(responses[0..2].map(&:ord)).to eq([0, 0, 2])
+
+    expect(responses[3].ord).to eq(0)
+    expect(decode_row(responses[3][1..]).first).to eq([2, "user2", "person2@example.com"])
+    expect(responses[4]).to eq([1].pack("C"))
+
+    status, count = responses[5].unpack("CL")
+    expect([status, count]).to eq([0, 2])
+    first, rest = decode_row(responses[5][5..])
+    second, = decode_row(rest)
+    expect([first, second]).to eq([
+      [1, "user1", "person1@example.com"],
+      [2, "user2", "person2@example.com"],
+    ])
+    expect(responses[6]).to eq([4].pack("C"))
+
+    result = run_script([
+      "select",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > (1, user1, person1@example.com)",
+      "(2, user2, person2@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "rolls back the inserts of a transaction" do
+    result = run_script([
+      "insert 1 user1 person1@example.com",
+      "begin",
+      "insert 2 user2 person2@example.com",
+      "select",
+      "rollback",
+      "select",
+      "commit",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > Executed.",
+      "db > Executed.",
+      "db > Executed.",
+      "db > (1, user1, person1@example.com)",
+      "(2, user2, person2@example.com)",
+      "Executed.",
+      "db > Executed.",
+      "db > (1, user1, person1@example.com)",
+      "Executed.",
+      "db > Error: No transaction open.",
+      "db > Bye!",
+    ])
+  end
+
+  it "keeps committed transactions after reopening" do
+    script = ["begin"]
+    script += (1..20).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ["commit", "begin", "insert 21 user21 person21@example.com", ".exit"]
+    run_script(script)
+
+    result = run_script([
+      "select",
+      ".exit",
+    ])
+    expect(result.length).to eq(22)
+    expect(result.first).to eq("db > (1, user1, person1@example.com)")
+    expect(result.last(3)).to match_array([
+      "(20, user20, person20@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "recovers committed rows from the log after a crash" do
+    # Inserting the 35th row needs an internal node split, which exits without closing the table
+    script = (1..35).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    result = run_script(script)
+    expect(result.last).to eq("db > Need to implement splitting internal node")
+
+    result = run_script([
+      "select",
+      ".exit",
+    ])
+    expect(result.length).to eq(36)
+    expect(result.first).to eq("db > (1, user1, person1@example.com)")
+    expect(result.last(3)).to match_array([
+      "(34, user34, person34@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "replays only the commits after the last checkpoint on every restart" do
+    crash_script((1..10).map { |i| "insert #{i} user#{i} person#{i}@example.com" })
+    crash_script((11..20).map { |i| "insert #{i} user#{i} person#{i}@example.com" })
+
+    result = run_script([
+      "select",
+      ".exit",
+    ])
+    expect(result.length).to eq(22)
+    expect(result.last(3)).to match_array([
+      "(20, user20, person20@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "writes committed pages back in the background" do
+    # Pages dirty for over a second are written back without closing the table
+    crash_script((1..3).map { |i| "insert #{i} user#{i} person#{i}@example.com" }, 1.5)
+    # The header page and the root leaf
+    expect(File.size("test.db")).to eq(8192)
+
+    result = run_script([
+      "select",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > (1, user1, person1@example.com)",
+      "(2, user2, person2@example.com)",
+      "(3, user3, person3@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "keeps the tree under the header page" do
+    run_script([
+      "insert 1 user1 person1@example.com",
+      ".exit",
+    ])
+    header = File.binread("test.db", 72)
+    magic = header[0, 16]
+    version, page_size, row_size, leaf_max_cells, root_page, free_list_head, page_count = header[16, 28].unpack("L7")
+    checkpoint_lsn, checkpoint_offset = header[44, 16].unpack("Q2")
+    username_index_root, email_index_root, leaf_layout = header[60, 12].unpack("L3")
+    expect(magic).to eq("db_tutorial_cpp\0")
+    expect([version, page_size, row_size, leaf_max_cells]).to eq([9, 4096, 297, 13])
+    expect([root_page, free_list_head, page_count]).to eq([1, 0, 2])
+    expect([checkpoint_lsn, checkpoint_offset]).to eq([3, 0])
+    expect([username_index_root, email_index_root, leaf_layout]).to eq([0, 0, 0])
+  end
+
+  it "refuses to open a file that is not a database" do
+    File.binwrite("test.db", "x" * 4096)
+    result = `echo .exit | ./db test.db 2>&1`.split("\n")
+    expect(result).to eq(["Error: test.db is not a database file."])
+  end
+
+  it "keeps the page size chosen when the database was created" do
+    `echo .exit | ./db test.db --page-size 16384`
+    expect(File.size("test.db")).to eq(2 * 16384)
+
+    script = (1..30).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script << ".constants"
+    script << ".exit"
+    result = run_script(script)
+    expect(result.last(9)).to match_array([
+      "db > Constants:",
+      "PAGE_SIZE: 16384",
+      "ROW_SIZE: 297",
+      "COMMON_NODE_HEADER_SIZE: 23",
+      "LEAF_NODE_HEADER_SIZE: 31",
+      "LEAF_NODE_CELL_SIZE: 305",
+      "LEAF_NODE_SPACE_FOR_CELLS: 16353",
+      "LEAF_NODE_MAX_CELLS: 53",
+      "db > Bye!",
+    ])
+
+    # 30 rows still fit in the root leaf
+    result = run_script([".btree", ".exit"])
+    expect(result[1]).to eq("- leaf (size 30)")
+  end
+
+  it "answers the same from PAX leaves as from row leaves" do
+    script = (1..30).map { |i| (i * 7) % 31 }.map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += [
+      "select",
+      "select where email = person17@example.com",
+      "select where username like user2%",
+      ".btree",
+      ".exit",
+    ]
+    expected = run_script(script)
+
+    `rm -f test.db test.db-wal`
+    `echo .exit | ./db test.db --layout pax`
+    result = run_script(script)
+    expect(result).to eq(expected)
+    expect(File.binread("test.db", 72)[68, 4].unpack1("L")).to eq(1)
+
+    # The layout stays with the file
+    result = run_script(["select where id = 17", ".exit"])
+    expect(result).to match_array([
+      "db > (17, user17, person17@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "answers the same from dictionary leaves as from row leaves" do
+    script = (1..30).map { |i| (i * 7) % 31 }.map do |i|
+      "insert #{i} user#{i % 3} person#{i % 5}@example.com"
+    end
+    script += [
+      "select",
+      "select where email = person4@example.com",
+      "select where email = nobody@example.com",
+      "select where username like user2%",
+      ".btree",
+      ".exit",
+    ]
+    expected = run_script(script)
+
+    `rm -f test.db test.db-wal`
+    `echo .exit | ./db test.db --layout dict`
+    result = run_script(script)
+    expect(result).to eq(expected)
+    expect(File.binread("test.db", 72)[68, 4].unpack1("L")).to eq(2)
+
+    # The layout stays with the file
+    result = run_script(["select where id = 17", ".exit"])
+    expect(result).to match_array([
+      "db > (17, user2, person2@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "keeps compressed pages in extents through writeback and crashes" do
+    `echo .exit | ./db test.db --compression lz`
+    expect(File.binread("test.db", 76)[72, 4].unpack1("L")).to eq(1)
+
+    crash_script((1..10).map { |i| "insert #{i} user#{i} person#{i}@example.com" }, 1.5)
+    crash_script((11..20).map { |i| "insert #{i} user#{i} person#{i}@example.com" })
+    result = run_script([
+      "select where email = person17@example.com",
+      "select",
+      ".exit",
+    ])
+    expect(result.length).to eq(24)
+    expect(result.first).to eq("db > (17, user17, person17@example.com)")
+    expect(result.last(3)).to match_array([
+      "(20, user20, person20@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+    # The header page and a leaf of 20 rows compressed to well under a page
+    expect(File.size("test.db") < 2 * 4096).to eq(true)
+  end
+
+  it "rejects page sizes that are not a power of two between 4K and 64K" do
+    result = `echo .exit | ./db test.db --page-size 5000 2>&1`.split("\n")
+    expect(result).to eq(["Error: page size must be a power of two between 4096 and 65536."])
+  end
+
+  it "finds rows by column value with and without an index" do
+    script = (1..20).map do |i|
+      "insert #{i} user#{i % 3} person#{i}@example.com"
+    end
+    queries = [
+      "select where username = user2",
+      "select where email like person1%",
+      "select where email = person7@example.com limit 1",
+    ]
+    script += queries
+    script << "create index on users(username)"
+    script << "create index on users(email)"
+    script += queries
+    script << ".exit"
+    result = run_script(script)
+
+    # Scans return rows by id, indexes by value: "person1@" sorts after "person19@"
+    by_username = (1..20).select { |i| i % 3 == 2 }
+    answers = lambda do |by_email|
+      [by_username, by_email, [7]].map do |ids|
+        rows = ids.map { |i| "(#{i}, user#{i % 3}, person#{i}@example.com)" }
+        ["db > " + rows.first] + rows.drop(1) + ["Executed."]
+      end.flatten
+    end
+    expect(result.drop(20)).to match_array(
+      answers.call([1] + (10..19).to_a) +
+      ["db > Executed.", "db > Executed."] +
+      answers.call((10..19).to_a + [1]) +
+      ["db > Bye!"]
+    )
+
+    # The indexes survive a restart and keep up with new rows
+    result = run_script([
+      "insert 21 user2 person21@example.com",
+      "create index on users(email)",
+      "select where username = user2 offset 6",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > Executed.",
+      "db > Error: Index already exists.",
+      "db > (20, user2, person20@example.com)",
+      "(21, user2, person21@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "splits index leaves of long values" do
+    # Values this long share no prefix, so a leaf only holds a few of them
+    email = lambda { |i| "#{i}@" + "x" * 200 }
+    script = ["create index on users(email)"]
+    script += (1..30).map { |i| "insert #{i} user#{i} #{email.call(i)}" }
+    script << ".exit"
+    run_script(script)
+
+    result = run_script([
+      "select where email like 1%",
+      "select where email = #{email.call(25)}",
+      ".exit",
+    ])
+    rows = ((10..19).to_a + [1]).map { |i| "(#{i}, user#{i}, #{email.call(i)})" }
+    expect(result).to match_array(
+      ["db > " + rows.first] + rows.drop(1) + ["Executed."] +
+      ["db > (25, user25, #{email.call(25)})", "Executed.", "db > Bye!"]
+    )
+  end
+
+  it "keeps an index in step with transactions and crashes" do
+    crash_script([
+      "create index on users(email)",
+      "insert 1 user1 person1@example.com",
+      "begin",
+      "insert 2 user2 person2@example.com",
+      "create index on users(username)",
+      "rollback",
+      "insert 3 user3 person3@example.com",
+    ])
+
+    result = run_script([
+      "select where email like person%",
+      "select where email = person2@example.com",
+      "select where id = 3",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > (1, user1, person1@example.com)",
+      "(3, user3, person3@example.com)",
+      "Executed.",
+      "db > Executed.",
+      "db > (3, user3, person3@example.com)",
+      "Executed.",
+      "db > Bye!",
+    ])
+  end
+
+  it "prints an error message for malformed where clauses and indexes" do
+    result = run_script([
+      "select where email like %example.com",
+      "select where nickname = bob",
+      "create index on users(nickname)",
+      "create index on accounts(email)",
+      ".exit",
+    ])
+    expect(result).to match_array([
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Syntax error. Could not parse statement.",
+      "db > Bye!",
+    ])
+  end
 end
@@ -0,0 +1,155 @@
+#ifndef DB_HEADER_PAGE_H
+#define DB_HEADER_PAGE_H
+
+#include <cstring>
+
+#include "compress.h"
+#include "node.h"
+
+/*
+ * Database Header Layout
+ *
+ * Page 0 of the file describes the database: the format it was
+ * written in, the layout constants and leaf layout it was written
+ * with, and where the tree and the secondary indexes start. It is
+ * written when the file is created and at every checkpoint, after
+ * the pages it describes are in the file, together with the redo LSN
+ * of the checkpoint and the offset in the log where the first commit
+ * at or after it starts.
+ *
+ * A compressed database stores every other page as an extent: a run
+ * of whole sectors anywhere after the header page, holding the page
+ * compressed. The header maps every page number to the first sector
+ * and the stored size of its extent; a page whose stored size is the
+ * page size is not compressed. A first sector of 0 means the page
+ * was never written.
+ */
+const char DB_MAGIC[] = "db_tutorial_cpp";
+const uint32_t DB_FORMAT_VERSION = 9;
+
+const uint32_t HEADER_MAGIC_SIZE = sizeof(DB_MAGIC);
+const uint32_t HEADER_MAGIC_OFFSET = 0;
+const uint32_t HEADER_FORMAT_VERSION_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_FORMAT_VERSION_OFFSET = HEADER_MAGIC_OFFSET + HEADER_MAGIC_SIZE;
+const uint32_t HEADER_PAGE_SIZE_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_PAGE_SIZE_OFFSET = HEADER_FORMAT_VERSION_OFFSET + HEADER_FORMAT_VERSION_SIZE;
+const uint32_t HEADER_ROW_SIZE_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_ROW_SIZE_OFFSET = HEADER_PAGE_SIZE_OFFSET + HEADER_PAGE_SIZE_SIZE;
+const uint32_t HEADER_LEAF_NODE_MAX_CELLS_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_LEAF_NODE_MAX_CELLS_OFFSET = HEADER_ROW_SIZE_OFFSET + HEADER_ROW_SIZE_SIZE;
+const uint32_t HEADER_ROOT_PAGE_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_ROOT_PAGE_OFFSET = HEADER_LEAF_NODE_MAX_CELLS_OFFSET + HEADER_LEAF_NODE_MAX_CELLS_SIZE;
+const uint32_t HEADER_FREE_LIST_HEAD_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_FREE_LIST_HEAD_OFFSET = HEADER_ROOT_PAGE_OFFSET + HEADER_ROOT_PAGE_SIZE;
+const uint32_t HEADER_PAGE_COUNT_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_PAGE_COUNT_OFFSET = HEADER_FREE_LIST_HEAD_OFFSET + HEADER_FREE_LIST_HEAD_SIZE;
+const uint32_t HEADER_CHECKPOINT_LSN_SIZE = sizeof(uint64_t);
+const uint32_t HEADER_CHECKPOINT_LSN_OFFSET = HEADER_PAGE_COUNT_OFFSET + HEADER_PAGE_COUNT_SIZE;
+const uint32_t HEADER_CHECKPOINT_OFFSET_SIZE = sizeof(uint64_t);
+const uint32_t HEADER_CHECKPOINT_OFFSET_OFFSET = HEADER_CHECKPOINT_LSN_OFFSET + HEADER_CHECKPOINT_LSN_SIZE;
+const uint32_t HEADER_USERNAME_INDEX_ROOT_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_USERNAME_INDEX_ROOT_OFFSET = HEADER_CHECKPOINT_OFFSET_OFFSET + HEADER_CHECKPOINT_OFFSET_SIZE;
+const uint32_t HEADER_EMAIL_INDEX_ROOT_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_EMAIL_INDEX_ROOT_OFFSET = HEADER_USERNAME_INDEX_ROOT_OFFSET + HEADER_USERNAME_INDEX_ROOT_SIZE;
+const uint32_t HEADER_LEAF_LAYOUT_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_LEAF_LAYOUT_OFFSET = HEADER_EMAIL_INDEX_ROOT_OFFSET + HEADER_EMAIL_INDEX_ROOT_SIZE;
+const uint32_t HEADER_COMPRESSION_SIZE = sizeof(uint32_t);
+const uint32_t HEADER_COMPRESSION_OFFSET = HEADER_LEAF_LAYOUT_OFFSET + HEADER_LEAF_LAYOUT_SIZE;
+const uint32_t HEADER_PAGE_MAP_ENTRY_SIZE = 2 * sizeof(uint32_t);
+const uint32_t HEADER_PAGE_MAP_OFFSET = HEADER_COMPRESSION_OFFSET + HEADER_COMPRESSION_SIZE;
+const uint32_t HEADER_PAGE_MAP_SIZE = TABLE_MAX_PAGES * HEADER_PAGE_MAP_ENTRY_SIZE;
+static_assert(HEADER_PAGE_MAP_OFFSET + HEADER_PAGE_MAP_SIZE <= MIN_PAGE_SIZE, "page map must fit in the header");
+
+#define EXTENT_SECTOR_SIZE 512
+
+class HeaderPage
+{
+private:
+    void *page;
+
+public:
+    HeaderPage(void *page) : page(page) {}
+
+    void initialize_header_page(uint32_t root_page_num, uint32_t page_size, LeafLayout layout,
+                                PageCompression compression)
+    {
+        memset(page, 0, page_size);
+        memcpy((char *)page + HEADER_MAGIC_OFFSET, DB_MAGIC, HEADER_MAGIC_SIZE);
+        *header_format_version() = DB_FORMAT_VERSION;
+        *header_page_size() = page_size;
+        *header_row_size() = ROW_SIZE;
+        *header_leaf_node_max_cells() = leaf_node_max_cells(page_size);
+        *header_root_page() = root_page_num;
+        *header_free_list_head() = 0; // 0 represents no free page
+        *header_page_count() = 1; // the root page is allocated by the table
+        *header_checkpoint_lsn() = 0;
+        *header_checkpoint_offset() = 0;
+        *header_index_root(COLUMN_USERNAME) = 0; // 0 represents no index
+        *header_index_root(COLUMN_EMAIL) = 0;
+        *header_leaf_layout() = layout;
+        *header_compression() = compression;
+    }
+    bool has_magic()
+    {
+        return !memcmp((char *)page + HEADER_MAGIC_OFFSET, DB_MAGIC, HEADER_MAGIC_SIZE);
+    }
+    uint32_t *header_format_version()
+    {
+        return (uint32_t *)((char *)page + HEADER_FORMAT_VERSION_OFFSET);
+    }
+    uint32_t *header_page_size()
+    {
+        return (uint32_t *)((char *)page + HEADER_PAGE_SIZE_OFFSET);
+    }
+    uint32_t *header_row_size()
+    {
+        return (uint32_t *)((char *)page + HEADER_ROW_SIZE_OFFSET);
+    }
+    uint32_t *header_leaf_node_max_cells()
+    {
+        return (uint32_t *)((char *)page + HEADER_LEAF_NODE_MAX_CELLS_OFFSET);
+    }
+    uint32_t *header_root_page()
+    {
+        return (uint32_t *)((char *)page + HEADER_ROOT_PAGE_OFFSET);
+    }
+    uint32_t *header_free_list_head()
+    {
+        return (uint32_t *)((char *)page + HEADER_FREE_LIST_HEAD_OFFSET);
+    }
+    uint32_t *header_page_count()
+    {
+        return (uint32_t *)((char *)page + HEADER_PAGE_COUNT_OFFSET);
+    }
+    uint64_t *header_checkpoint_lsn()
+    {
+        return (uint64_t *)((char *)page + HEADER_CHECKPOINT_LSN_OFFSET);
+    }
+    uint64_t *header_checkpoint_offset()
+    {
+        return (uint64_t *)((char *)page + HEADER_CHECKPOINT_OFFSET_OFFSET);
+    }
+    uint32_t *header_leaf_layout()
+    {
+        return (uint32_t *)((char *)page + HEADER_LEAF_LAYOUT_OFFSET);
+    }
+    uint32_t *header_compression()
+    {
+        return (uint32_t *)((char *)page + HEADER_COMPRESSION_OFFSET);
+    }
+    uint32_t *header_extent_sector(uint32_t page_num)
+    {
+        return (uint32_t *)((char *)page + HEADER_PAGE_MAP_OFFSET + page_num * HEADER_PAGE_MAP_ENTRY_SIZE);
+    }
+    uint32_t *header_extent_size(uint32_t page_num)
+    {
+        return header_extent_sector(page_num) + 1;
+    }
+    uint32_t *header_index_root(Column column)
+    {
+        uint32_t offset = column == COLUMN_USERNAME ? HEADER_USERNAME_INDEX_ROOT_OFFSET : HEADER_EMAIL_INDEX_ROOT_OFFSET;
+        return (uint32_t *)((char *)page + offset);
+    }
+};
+
+#endif
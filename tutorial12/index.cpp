@@ -0,0 +1,310 @@
+#include <iostream>
+
+#include "index.h"
+
+Index::Index(Table *table, Column column) : table(table), column(column)
+{
+    root_page_num = table->pager.get_index_root(column);
+}
+bool Index::exists()
+{
+    return root_page_num != 0;
+}
+uint32_t Index::build(Cursor *cursor, std::vector<Row> &rows)
+{
+    /*
+    Fill a new index with the given rows. It stays invisible until its
+    pages are committed and set_root_page_num publishes it.
+    */
+    uint32_t new_root_page_num = cursor->allocate_page();
+    IndexLeafNode root_node = table->pager.get_page(new_root_page_num);
+    root_node.initialize_index_leaf_node(table->pager.get_page_size());
+    root_node.set_node_root(true);
+
+    char key[INDEX_MAX_KEY_SIZE];
+    for (Row &row : rows)
+    {
+        uint32_t key_size = make_index_key(key, row_string_column(row, column), row.id);
+        /* Nobody else can reach the new pages, they need no latches */
+        insert_key(cursor, new_root_page_num, key, key_size, false);
+    }
+    return new_root_page_num;
+}
+void Index::set_root_page_num(uint32_t root_page_num)
+{
+    this->root_page_num = root_page_num;
+    table->pager.set_index_root(column, root_page_num);
+}
+void Index::insert(Cursor *cursor, Row &row)
+{
+    char key[INDEX_MAX_KEY_SIZE];
+    uint32_t key_size = make_index_key(key, row_string_column(row, column), row.id);
+    insert_key(cursor, root_page_num, key, key_size, true);
+}
+void Index::insert_key(Cursor *cursor, uint32_t root_page_num, const char *key, uint32_t key_size, bool latch)
+{
+    /*
+    Latch the whole path from the root: a split changes the parent,
+    and the cursor keeps the latches until the insert commits.
+    */
+    std::vector<uint32_t> path;
+    uint32_t page_num = root_page_num;
+    while (true)
+    {
+        if (latch)
+        {
+            table->pager.latch_page(page_num, LATCH_EXCLUSIVE);
+            cursor->latched_pages.push_back(page_num);
+        }
+        path.push_back(page_num);
+
+        Node node = table->pager.get_page(page_num);
+        if (node.get_node_type() == NODE_LEAF)
+        {
+            break;
+        }
+        IndexInternalNode internal_node = node.get_node();
+        page_num = internal_node.index_internal_node_child(internal_node.index_internal_node_find_child(key, key_size));
+    }
+
+    IndexLeafNode leaf_node = table->pager.get_page(page_num);
+    uint32_t cell_num = leaf_node.index_leaf_node_find_cell(key, key_size);
+    cursor->mark_page_written(page_num);
+    if (leaf_node.index_node_insert(cell_num, key, key_size, 0))
+    {
+        return;
+    }
+
+    /*
+    The key does not share the leaf's prefix or there is no room left:
+    rewrite the leaf with the prefix of all its keys, or split it.
+    */
+    std::vector<std::string> keys;
+    std::vector<uint32_t> values;
+    leaf_node.index_node_read(keys, values);
+    keys.emplace(keys.begin() + cell_num, key, key_size);
+    values.emplace(values.begin() + cell_num, 0);
+
+    uint32_t total_key_size = 0;
+    for (std::string &k : keys)
+    {
+        total_key_size += k.size();
+    }
+    uint32_t prefix_size = common_prefix_size(keys.front(), keys.back());
+    if (leaf_node.index_node_size_for(keys.size(), total_key_size, prefix_size) <= *leaf_node.node_page_size())
+    {
+        leaf_node.index_node_write(keys, values, 0, keys.size());
+        return;
+    }
+    leaf_node_split_and_insert(cursor, path, keys, values);
+}
+void Index::leaf_node_split_and_insert(Cursor *cursor, std::vector<uint32_t> &path, std::vector<std::string> &keys,
+                                       std::vector<uint32_t> &values)
+{
+    /*
+    Divide the keys of the full leaf and the new key between the leaf
+    (left) and a new leaf (right), as evenly by size as both halves
+    allow, then add the new leaf to the parent or create a new root.
+    */
+    uint32_t old_page_num = path.back();
+    IndexLeafNode old_node = table->pager.get_page(old_page_num);
+    uint32_t page_size = *old_node.node_page_size();
+    uint32_t num_keys = keys.size();
+
+    /* key_sizes[i] is the size of the first i keys */
+    std::vector<uint32_t> key_sizes(num_keys + 1, 0);
+    for (uint32_t i = 0; i < num_keys; i++)
+    {
+        key_sizes[i + 1] = key_sizes[i] + keys[i].size();
+    }
+    /*
+    Splitting next to the new key always works, since the other keys
+    fitted before, but the split closest to the middle is chosen.
+    */
+    uint32_t split = 0;
+    uint32_t best_difference = UINT32_MAX;
+    for (uint32_t i = 1; i < num_keys; i++)
+    {
+        uint32_t left_size = old_node.index_node_size_for(i, key_sizes[i], common_prefix_size(keys[0], keys[i - 1]));
+        uint32_t right_size = old_node.index_node_size_for(num_keys - i, key_sizes[num_keys] - key_sizes[i],
+                                                            common_prefix_size(keys[i], keys[num_keys - 1]));
+        if (left_size > page_size || right_size > page_size)
+        {
+            continue;
+        }
+        uint32_t difference = left_size > right_size ? left_size - right_size : right_size - left_size;
+        if (difference < best_difference)
+        {
+            best_difference = difference;
+            split = i;
+        }
+    }
+
+    uint32_t new_page_num = cursor->allocate_page();
+    IndexLeafNode new_node = table->pager.get_page(new_page_num);
+    new_node.initialize_index_leaf_node(page_size);
+    *new_node.index_leaf_node_next_leaf() = *old_node.index_leaf_node_next_leaf();
+    *old_node.index_leaf_node_next_leaf() = new_page_num;
+    old_node.index_node_write(keys, values, 0, split);
+    new_node.index_node_write(keys, values, split, num_keys);
+
+    /*
+    The separator only needs to tell the last key of the left leaf from
+    the first of the right one: the first key of the right leaf up to
+    and including the first byte that differs.
+    */
+    std::string separator = keys[split].substr(0, common_prefix_size(keys[split - 1], keys[split]) + 1);
+
+    if (path.size() == 1)
+    {
+        create_new_root(cursor, old_page_num, separator, new_page_num);
+        return;
+    }
+    internal_node_insert(cursor, path[path.size() - 2], old_page_num, separator, new_page_num);
+}
+void Index::internal_node_insert(Cursor *cursor, uint32_t parent_page_num, uint32_t left_page_num,
+                                 const std::string &separator, uint32_t right_page_num)
+{
+    /*
+    The left child was split into itself and the right child, which
+    takes over its place in the parent: the left child gets a new cell
+    with the separator, followed by the right child.
+    */
+    IndexInternalNode parent = table->pager.get_page(parent_page_num);
+    uint32_t num_keys = *parent.index_node_num_keys();
+    uint32_t index = 0;
+    while (parent.index_internal_node_child(index) != left_page_num)
+    {
+        index++;
+    }
+
+    cursor->mark_page_written(parent_page_num);
+    if (!parent.index_node_insert(index, separator.data(), separator.size(), left_page_num))
+    {
+        std::vector<std::string> keys;
+        std::vector<uint32_t> values;
+        parent.index_node_read(keys, values);
+        keys.insert(keys.begin() + index, separator);
+        values.insert(values.begin() + index, left_page_num);
+
+        uint32_t total_key_size = 0;
+        for (const std::string &key : keys)
+        {
+            total_key_size += key.size();
+        }
+        if (parent.index_node_size_for(num_keys + 1, total_key_size, common_prefix_size(keys.front(), keys.back())) >
+            *parent.node_page_size())
+        {
+            std::cout << "Need to implement splitting internal node" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        parent.index_node_write(keys, values, 0, keys.size());
+    }
+    parent.set_index_internal_node_child(index + 1, right_page_num);
+}
+void Index::create_new_root(Cursor *cursor, uint32_t root_page_num, const std::string &separator,
+                            uint32_t right_child_page_num)
+{
+    /*
+    The root keeps its page: its keys move to a new left child and it
+    becomes an internal node over the left and right children.
+    */
+    IndexInternalNode root = table->pager.get_page(root_page_num);
+    uint32_t left_child_page_num = cursor->allocate_page();
+    IndexLeafNode left_child = table->pager.get_page(left_child_page_num);
+
+    memcpy(left_child.get_node(), root.get_node(), table->pager.get_page_size());
+    left_child.set_node_root(false);
+    /* The copy carries the root's locked version; the new page is not latched */
+    *left_child.node_version() = 0;
+
+    root.initialize_index_internal_node(table->pager.get_page_size());
+    root.set_node_root(true);
+    root.index_node_insert(0, separator.data(), separator.size(), left_child_page_num);
+    *root.index_internal_node_right_child() = right_child_page_num;
+}
+void Index::find(const char *value, bool prefix, Transaction *transaction, std::vector<uint64_t> &ids)
+{
+    /*
+    Collect the ids of the rows whose value equals value, or starts
+    with it if prefix is set. Either way the matching keys are next
+    to each other, starting at the first key not less than the value.
+    Keys of equal values start with the value and its zero byte, keys
+    of values with the prefix just with the prefix.
+    */
+    char key[INDEX_MAX_KEY_SIZE];
+    uint32_t key_size = strnlen(value, COLUMN_EMAIL_SIZE);
+    memcpy(key, value, key_size);
+    if (!prefix)
+    {
+        key[key_size++] = '\0';
+    }
+
+    /* Read the root before the snapshot, which then includes the index's creation */
+    uint32_t page_num = root_page_num;
+    bool is_snapshot = transaction == nullptr;
+    uint64_t snapshot_ts = 0;
+    void *page;
+    if (is_snapshot)
+    {
+        snapshot_ts = table->pager.begin_snapshot();
+        page = malloc(table->pager.get_page_size());
+        table->pager.read_page_version(page_num, snapshot_ts, page);
+    }
+    else
+    {
+        page = table->pager.get_page(page_num);
+    }
+
+    while (Node(page).get_node_type() == NODE_INTERNAL)
+    {
+        IndexInternalNode internal_node = page;
+        page_num = internal_node.index_internal_node_child(internal_node.index_internal_node_find_child(key, key_size));
+        if (is_snapshot)
+        {
+            table->pager.read_page_version(page_num, snapshot_ts, page);
+        }
+        else
+        {
+            page = table->pager.get_page(page_num);
+        }
+    }
+
+    IndexLeafNode leaf_node = page;
+    uint32_t cell_num = leaf_node.index_leaf_node_find_cell(key, key_size);
+    while (true)
+    {
+        if (cell_num >= *leaf_node.index_node_num_keys())
+        {
+            page_num = *leaf_node.index_leaf_node_next_leaf();
+            if (page_num == 0)
+            {
+                break;
+            }
+            if (is_snapshot)
+            {
+                table->pager.read_page_version(page_num, snapshot_ts, page);
+            }
+            else
+            {
+                page = table->pager.get_page(page_num);
+                leaf_node = page;
+            }
+            cell_num = 0;
+            continue;
+        }
+
+        if (!leaf_node.index_leaf_node_key_starts_with(cell_num, key, key_size))
+        {
+            break;
+        }
+        ids.push_back(leaf_node.index_leaf_node_id(cell_num));
+        cell_num++;
+    }
+
+    if (is_snapshot)
+    {
+        free(page);
+        table->pager.end_snapshot(snapshot_ts);
+    }
+}
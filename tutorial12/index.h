@@ -0,0 +1,48 @@
+#ifndef DB_INDEX_H
+#define DB_INDEX_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "index_node.h"
+#include "table.h"
+
+/*
+Index is a secondary index on the username or email column: a B-tree
+from column values to the ids of the rows holding them, kept in the
+same file as the table and created with Database::create_index.
+
+Every insert adds its index entries through the cursor of the row
+insert, so they are latched, logged, and committed or rolled back
+together with the row. Lookups read the index as of a snapshot, or
+the live index inside a transaction, like scans of the table.
+
+Like the table, an index cannot split internal nodes yet, but its
+nodes hold as many keys as fit in the page rather than a fixed number.
+*/
+class Index
+{
+private:
+    Table *table;
+    Column column;
+    std::atomic<uint32_t> root_page_num; // 0 until the index is created
+
+    void insert_key(Cursor *cursor, uint32_t root_page_num, const char *key, uint32_t key_size, bool latch);
+    void leaf_node_split_and_insert(Cursor *cursor, std::vector<uint32_t> &path, std::vector<std::string> &keys,
+                                    std::vector<uint32_t> &values);
+    void internal_node_insert(Cursor *cursor, uint32_t parent_page_num, uint32_t left_page_num,
+                              const std::string &separator, uint32_t right_page_num);
+    void create_new_root(Cursor *cursor, uint32_t root_page_num, const std::string &separator,
+                         uint32_t right_child_page_num);
+
+public:
+    Index(Table *table, Column column);
+    bool exists();
+    uint32_t build(Cursor *cursor, std::vector<Row> &rows);
+    void set_root_page_num(uint32_t root_page_num);
+    void insert(Cursor *cursor, Row &row);
+    void find(const char *value, bool prefix, Transaction *transaction, std::vector<uint64_t> &ids);
+};
+
+#endif
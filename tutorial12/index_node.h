@@ -0,0 +1,370 @@
+#ifndef DB_INDEX_NODE_H
+#define DB_INDEX_NODE_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "node.h"
+
+/*
+ * Index Key Layout
+ *
+ * A secondary index is a B-tree of its own in the same file as the
+ * table. Its keys are byte strings: the column value, a zero byte,
+ * and the id of the row in big-endian order, which keeps keys unique
+ * where values are not. Comparing keys byte by byte, a shorter key
+ * first, orders them like strcmp on the values and then by id, so
+ * rows with equal values, and rows whose values share a prefix, are
+ * next to each other.
+ */
+const uint32_t INDEX_ID_SIZE = sizeof(uint64_t);
+const uint32_t INDEX_MAX_KEY_SIZE = COLUMN_EMAIL_SIZE + 1 + INDEX_ID_SIZE;
+
+inline uint32_t make_index_key(char *key, const char *value, uint64_t id)
+{
+    /* Return the size of the key */
+    uint32_t value_size = strnlen(value, COLUMN_EMAIL_SIZE);
+    memcpy(key, value, value_size);
+    key[value_size] = '\0';
+    for (uint32_t i = 0; i < INDEX_ID_SIZE; i++)
+    {
+        key[value_size + 1 + i] = (char)(id >> (8 * (INDEX_ID_SIZE - 1 - i)));
+    }
+    return value_size + 1 + INDEX_ID_SIZE;
+}
+inline uint64_t index_key_id(const char *key, uint32_t key_size)
+{
+    uint64_t id = 0;
+    for (uint32_t i = key_size - INDEX_ID_SIZE; i < key_size; i++)
+    {
+        id = (id << 8) | (uint8_t)key[i];
+    }
+    return id;
+}
+inline int compare_index_keys(const char *a, uint32_t a_size, const char *b, uint32_t b_size)
+{
+    int result = memcmp(a, b, std::min(a_size, b_size));
+    if (result != 0)
+    {
+        return result;
+    }
+    return a_size < b_size ? -1 : (a_size > b_size ? 1 : 0);
+}
+inline uint32_t common_prefix_size(const std::string &a, const std::string &b)
+{
+    uint32_t size = 0;
+    while (size < a.size() && size < b.size() && a[size] == b[size])
+    {
+        size++;
+    }
+    return size;
+}
+
+/*
+ * Index Node Layout
+ *
+ * Index leaves have the header of a table leaf and index internal
+ * nodes the number of keys and right child of a table internal node,
+ * which puts the number of keys and the end of the header at the same
+ * place in both. The rest of the page is shared:
+ *
+ * - the prefix common to every key in the node, stored once,
+ * - an array of 16-bit offsets to the cells, in key order,
+ * - the cells, allocated from the end of the page towards the array:
+ *   the size of the key without the prefix, the rest of the key, and
+ *   in internal nodes the child the key separates from its right.
+ *
+ * Internal nodes keep separators instead of whole keys: the shortest
+ * prefix of the first key of the right child that is still greater
+ * than the last key of the left child. Every key in child i is less
+ * than separator i and not less than separator i - 1.
+ */
+const uint32_t INDEX_NODE_NUM_KEYS_SIZE = sizeof(uint32_t);
+const uint32_t INDEX_NODE_NUM_KEYS_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t INDEX_NODE_PREFIX_SIZE_SIZE = sizeof(uint32_t);
+const uint32_t INDEX_NODE_PREFIX_SIZE_OFFSET = LEAF_NODE_HEADER_SIZE;
+const uint32_t INDEX_NODE_CELLS_START_SIZE = sizeof(uint32_t);
+const uint32_t INDEX_NODE_CELLS_START_OFFSET = INDEX_NODE_PREFIX_SIZE_OFFSET + INDEX_NODE_PREFIX_SIZE_SIZE;
+const uint32_t INDEX_NODE_HEADER_SIZE = INDEX_NODE_CELLS_START_OFFSET + INDEX_NODE_CELLS_START_SIZE;
+const uint32_t INDEX_NODE_SLOT_SIZE = sizeof(uint16_t);
+const uint32_t INDEX_NODE_SUFFIX_SIZE_SIZE = sizeof(uint16_t);
+
+static_assert(INDEX_NODE_NUM_KEYS_OFFSET == LEAF_NODE_NUM_CELLS_OFFSET &&
+                  INDEX_NODE_NUM_KEYS_OFFSET == INTERNAL_NODE_NUM_KEYS_OFFSET,
+              "index leaves and internal nodes count their keys in the same place");
+static_assert(INDEX_NODE_PREFIX_SIZE_OFFSET == INTERNAL_NODE_RIGHT_CHILD_OFFSET + INTERNAL_NODE_RIGHT_CHILD_SIZE,
+              "the index node header follows the right child of an internal node");
+
+class IndexNode : public Node
+{
+private:
+    uint16_t *index_node_slot(uint32_t key_num)
+    {
+        return (uint16_t *)((char *)node + INDEX_NODE_HEADER_SIZE + *index_node_prefix_size()) + key_num;
+    }
+    char *index_node_cell(uint32_t key_num)
+    {
+        return (char *)node + *index_node_slot(key_num);
+    }
+    uint32_t index_node_cell_size(uint32_t suffix_size)
+    {
+        return INDEX_NODE_SUFFIX_SIZE_SIZE + suffix_size + index_node_value_size();
+    }
+
+public:
+    IndexNode() {}
+    IndexNode(void *node) : Node(node) {}
+
+    void initialize_index_node(uint32_t page_size, NodeType type)
+    {
+        *node_page_size() = page_size;
+        set_node_type(type);
+        set_node_root(false);
+        *index_node_num_keys() = 0;
+        *index_node_prefix_size() = 0;
+        *index_node_cells_start() = page_size;
+    }
+    uint32_t *index_node_num_keys()
+    {
+        return (uint32_t *)((char *)node + INDEX_NODE_NUM_KEYS_OFFSET);
+    }
+    uint32_t *index_node_prefix_size()
+    {
+        return (uint32_t *)((char *)node + INDEX_NODE_PREFIX_SIZE_OFFSET);
+    }
+    uint32_t *index_node_cells_start()
+    {
+        return (uint32_t *)((char *)node + INDEX_NODE_CELLS_START_OFFSET);
+    }
+    char *index_node_prefix()
+    {
+        return (char *)node + INDEX_NODE_HEADER_SIZE;
+    }
+    uint32_t index_node_value_size()
+    {
+        /* Internal nodes keep a child pointer with every key */
+        return get_node_type() == NODE_INTERNAL ? INTERNAL_NODE_CHILD_SIZE : 0;
+    }
+    uint32_t index_node_suffix_size(uint32_t key_num)
+    {
+        uint16_t size;
+        memcpy(&size, index_node_cell(key_num), INDEX_NODE_SUFFIX_SIZE_SIZE);
+        return size;
+    }
+    char *index_node_suffix(uint32_t key_num)
+    {
+        return index_node_cell(key_num) + INDEX_NODE_SUFFIX_SIZE_SIZE;
+    }
+    char *index_node_value(uint32_t key_num)
+    {
+        return index_node_suffix(key_num) + index_node_suffix_size(key_num);
+    }
+    uint32_t index_node_key_size(uint32_t key_num)
+    {
+        return *index_node_prefix_size() + index_node_suffix_size(key_num);
+    }
+    uint32_t index_node_key(uint32_t key_num, char *key)
+    {
+        /* Copy the whole key out of the node and return its size */
+        uint32_t prefix_size = *index_node_prefix_size();
+        uint32_t suffix_size = index_node_suffix_size(key_num);
+        memcpy(key, index_node_prefix(), prefix_size);
+        memcpy(key + prefix_size, index_node_suffix(key_num), suffix_size);
+        return prefix_size + suffix_size;
+    }
+    uint32_t index_node_free_space()
+    {
+        uint32_t slots_end = INDEX_NODE_HEADER_SIZE + *index_node_prefix_size() +
+                             *index_node_num_keys() * INDEX_NODE_SLOT_SIZE;
+        return *index_node_cells_start() - slots_end;
+    }
+    uint32_t index_node_search(const char *key, uint32_t key_size, bool after_equal)
+    {
+        /*
+        Return the position of the first key not less than key, or the
+        first key greater than key if after_equal is set. The prefix is
+        compared once: a key that does not share it goes before or
+        after every key in the node, the others only compare suffixes.
+        */
+        uint32_t num_keys = *index_node_num_keys();
+        uint32_t prefix_size = *index_node_prefix_size();
+        int result = memcmp(index_node_prefix(), key, std::min(prefix_size, key_size));
+        if (result != 0)
+        {
+            return result > 0 ? 0 : num_keys;
+        }
+        if (key_size < prefix_size)
+        {
+            return 0;
+        }
+
+        const char *suffix = key + prefix_size;
+        uint32_t suffix_size = key_size - prefix_size;
+        uint32_t min_index = 0;
+        uint32_t one_past_max_index = num_keys;
+        while (one_past_max_index != min_index)
+        {
+            uint32_t index = (min_index + one_past_max_index) / 2;
+            int result = compare_index_keys(index_node_suffix(index), index_node_suffix_size(index), suffix,
+                                            suffix_size);
+            if (result < 0 || (after_equal && result == 0))
+            {
+                min_index = index + 1;
+            }
+            else
+            {
+                one_past_max_index = index;
+            }
+        }
+        return min_index;
+    }
+    bool index_node_insert(uint32_t key_num, const char *key, uint32_t key_size, uint32_t value)
+    {
+        /*
+        Insert the key, and in internal nodes the child in value, at
+        position key_num in place. Fails if the key does not share the
+        node's prefix or there is no room, and the node has to be
+        rewritten or split instead.
+        */
+        uint32_t prefix_size = *index_node_prefix_size();
+        if (key_size < prefix_size || memcmp(key, index_node_prefix(), prefix_size) != 0)
+        {
+            return false;
+        }
+        uint32_t suffix_size = key_size - prefix_size;
+        uint32_t cell_size = index_node_cell_size(suffix_size);
+        if (index_node_free_space() < cell_size + INDEX_NODE_SLOT_SIZE)
+        {
+            return false;
+        }
+
+        uint32_t cell_offset = *index_node_cells_start() - cell_size;
+        char *cell = (char *)node + cell_offset;
+        uint16_t stored_suffix_size = suffix_size;
+        memcpy(cell, &stored_suffix_size, INDEX_NODE_SUFFIX_SIZE_SIZE);
+        memcpy(cell + INDEX_NODE_SUFFIX_SIZE_SIZE, key + prefix_size, suffix_size);
+        memcpy(cell + INDEX_NODE_SUFFIX_SIZE_SIZE + suffix_size, &value, index_node_value_size());
+        *index_node_cells_start() = cell_offset;
+
+        uint32_t num_keys = *index_node_num_keys();
+        memmove(index_node_slot(key_num + 1), index_node_slot(key_num), (num_keys - key_num) * INDEX_NODE_SLOT_SIZE);
+        *index_node_slot(key_num) = cell_offset;
+        *index_node_num_keys() = num_keys + 1;
+        return true;
+    }
+    void index_node_read(std::vector<std::string> &keys, std::vector<uint32_t> &values)
+    {
+        /* Copy every key, and child pointer in internal nodes, out of the node */
+        char key[INDEX_MAX_KEY_SIZE];
+        for (uint32_t i = 0; i < *index_node_num_keys(); i++)
+        {
+            keys.emplace_back(key, index_node_key(i, key));
+            uint32_t value = 0;
+            memcpy(&value, index_node_value(i), index_node_value_size());
+            values.push_back(value);
+        }
+    }
+    uint32_t index_node_size_for(uint32_t num_keys, uint32_t total_key_size, uint32_t prefix_size)
+    {
+        /* Bytes that num_keys keys sharing prefix_size bytes take in a node of this type */
+        return INDEX_NODE_HEADER_SIZE + prefix_size + num_keys * (INDEX_NODE_SLOT_SIZE + index_node_cell_size(0)) +
+               total_key_size - num_keys * prefix_size;
+    }
+    void index_node_write(const std::vector<std::string> &keys, const std::vector<uint32_t> &values,
+                          uint32_t begin, uint32_t end)
+    {
+        /*
+        Replace the keys of the node with keys begin to end, which must
+        fit. Keys are sorted, so the prefix common to all of them is the
+        one the first and last keys share.
+        */
+        uint32_t prefix_size = begin == end ? 0 : common_prefix_size(keys[begin], keys[end - 1]);
+        *index_node_num_keys() = 0;
+        *index_node_prefix_size() = prefix_size;
+        *index_node_cells_start() = *node_page_size();
+        if (begin != end)
+        {
+            memcpy(index_node_prefix(), keys[begin].data(), prefix_size);
+        }
+        for (uint32_t i = begin; i < end; i++)
+        {
+            index_node_insert(i - begin, keys[i].data(), keys[i].size(), values[i]);
+        }
+    }
+};
+
+class IndexLeafNode : public IndexNode
+{
+public:
+    IndexLeafNode() {}
+    IndexLeafNode(void *node) : IndexNode(node) {}
+
+    void initialize_index_leaf_node(uint32_t page_size)
+    {
+        initialize_index_node(page_size, NODE_LEAF);
+        *index_leaf_node_next_leaf() = 0; // 0 represents no sibling
+    }
+    uint32_t *index_leaf_node_next_leaf()
+    {
+        return (uint32_t *)((char *)node + LEAF_NODE_NEXT_LEAF_OFFSET);
+    }
+    uint64_t index_leaf_node_id(uint32_t key_num)
+    {
+        char key[INDEX_MAX_KEY_SIZE];
+        return index_key_id(key, index_node_key(key_num, key));
+    }
+    uint32_t index_leaf_node_find_cell(const char *key, uint32_t key_size)
+    {
+        /* Return the position of the first key not less than key */
+        return index_node_search(key, key_size, false);
+    }
+    bool index_leaf_node_key_starts_with(uint32_t key_num, const char *value, uint32_t value_size)
+    {
+        char key[INDEX_MAX_KEY_SIZE];
+        uint32_t key_size = index_node_key(key_num, key);
+        return key_size >= value_size && memcmp(key, value, value_size) == 0;
+    }
+};
+
+class IndexInternalNode : public IndexNode
+{
+public:
+    IndexInternalNode() {}
+    IndexInternalNode(void *node) : IndexNode(node) {}
+
+    void initialize_index_internal_node(uint32_t page_size)
+    {
+        initialize_index_node(page_size, NODE_INTERNAL);
+    }
+    uint32_t *index_internal_node_right_child()
+    {
+        return (uint32_t *)((char *)node + INTERNAL_NODE_RIGHT_CHILD_OFFSET);
+    }
+    uint32_t index_internal_node_child(uint32_t child_num)
+    {
+        if (child_num == *index_node_num_keys())
+        {
+            return *index_internal_node_right_child();
+        }
+        uint32_t child;
+        memcpy(&child, index_node_value(child_num), INTERNAL_NODE_CHILD_SIZE);
+        return child;
+    }
+    void set_index_internal_node_child(uint32_t child_num, uint32_t child)
+    {
+        if (child_num == *index_node_num_keys())
+        {
+            *index_internal_node_right_child() = child;
+            return;
+        }
+        memcpy(index_node_value(child_num), &child, INTERNAL_NODE_CHILD_SIZE);
+    }
+    uint32_t index_internal_node_find_child(const char *key, uint32_t key_size)
+    {
+        /* Return the index of the child which should contain the key */
+        return index_node_search(key, key_size, true);
+    }
+};
+
+#endif
@@ -0,0 +1,835 @@
+#ifndef DB_NODE_H
+#define DB_NODE_H
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "row.h"
+
+enum NodeType
+{
+    NODE_INTERNAL,
+    NODE_LEAF
+};
+/*
+How a leaf arranges its rows, chosen per database like the page size.
+LEAF_LAYOUT_ROWS keeps each key next to its serialized row. LEAF_LAYOUT_PAX
+keeps one minipage per column (keys, then usernames, then emails),
+so a scan that only needs some columns only touches their minipages.
+LEAF_LAYOUT_DICT is PAX with the string minipages turned into per-leaf
+dictionaries: cells store small codes, and filters compare codes.
+*/
+enum LeafLayout
+{
+    LEAF_LAYOUT_ROWS,
+    LEAF_LAYOUT_PAX,
+    LEAF_LAYOUT_DICT
+};
+#define TABLE_MAX_PAGES 100
+
+/*
+Every database picks its page size when it is created: a power of
+two between MIN_PAGE_SIZE and MAX_PAGE_SIZE, recorded in the header
+page. Nodes also record it, so their layout can be computed from the
+page alone.
+*/
+const uint32_t DEFAULT_PAGE_SIZE = 4096;
+const uint32_t MIN_PAGE_SIZE = 4096;
+const uint32_t MAX_PAGE_SIZE = 65536;
+
+constexpr bool is_valid_page_size(uint32_t page_size)
+{
+    return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+           (page_size & (page_size - 1)) == 0;
+}
+
+/*
+ * Common Node Header Layout
+ *
+ * The version word comes first so it is aligned for atomic access.
+ * It is odd while a writer holds the node's exclusive latch and
+ * advances on every unlatch, which lets readers validate a node
+ * they read without taking its latch.
+ *
+ * The LSN of the last commit that changed the node comes next.
+ * Recovery compares it with the log to skip pages that already
+ * reached the file. The size of the page the node lives in and, for
+ * leaves, the layout of their rows end the header.
+ */
+const uint32_t NODE_VERSION_SIZE = sizeof(uint32_t);
+const uint32_t NODE_VERSION_OFFSET = 0;
+const uint32_t NODE_TYPE_SIZE = sizeof(uint8_t);
+const uint32_t NODE_TYPE_OFFSET = NODE_VERSION_OFFSET + NODE_VERSION_SIZE;
+const uint32_t IS_ROOT_SIZE = sizeof(uint8_t);
+const uint32_t IS_ROOT_OFFSET = NODE_TYPE_OFFSET + NODE_TYPE_SIZE;
+const uint32_t PARENT_POINTER_SIZE = sizeof(uint32_t);
+const uint32_t PARENT_POINTER_OFFSET = IS_ROOT_OFFSET + IS_ROOT_SIZE;
+const uint32_t NODE_LSN_SIZE = sizeof(uint64_t);
+const uint32_t NODE_LSN_OFFSET = PARENT_POINTER_OFFSET + PARENT_POINTER_SIZE;
+const uint32_t NODE_PAGE_SIZE_SIZE = sizeof(uint32_t);
+const uint32_t NODE_PAGE_SIZE_OFFSET = NODE_LSN_OFFSET + NODE_LSN_SIZE;
+const uint32_t NODE_LEAF_LAYOUT_SIZE = sizeof(uint8_t);
+const uint32_t NODE_LEAF_LAYOUT_OFFSET = NODE_PAGE_SIZE_OFFSET + NODE_PAGE_SIZE_SIZE;
+const uint32_t COMMON_NODE_HEADER_SIZE =
+    NODE_VERSION_SIZE + NODE_TYPE_SIZE + IS_ROOT_SIZE + PARENT_POINTER_SIZE + NODE_LSN_SIZE +
+    NODE_PAGE_SIZE_SIZE + NODE_LEAF_LAYOUT_SIZE;
+
+/*
+Node, LeafNode and InternalNode are views over a page buffer. They
+hold nothing but the page pointer and are passed by value; code that
+does not know which kind of node a page holds checks its node type
+and wraps the page in the matching view.
+*/
+class Node
+{
+protected:
+    void *node;
+
+public:
+    Node() {}
+    Node(void *node) : node(node) {}
+
+    NodeType get_node_type()
+    {
+        uint8_t value = *((uint8_t *)((char *)node + NODE_TYPE_OFFSET));
+        return (NodeType)value;
+    }
+    void set_node_type(NodeType type)
+    {
+        *((uint8_t *)((char *)node + NODE_TYPE_OFFSET)) = (uint8_t)type;
+    }
+    void *get_node()
+    {
+        return node;
+    }
+    bool is_node_root()
+    {
+        uint8_t value = *((uint8_t *)((char *)node + IS_ROOT_OFFSET));
+        return value == 1;
+    }
+    void set_node_root(bool is_root)
+    {
+        *((uint8_t *)((char *)node + IS_ROOT_OFFSET)) = is_root ? 1 : 0;
+    }
+    uint32_t *node_parent()
+    {
+        return (uint32_t *)((char *)node + PARENT_POINTER_OFFSET);
+    }
+    uint32_t *node_page_size()
+    {
+        return (uint32_t *)((char *)node + NODE_PAGE_SIZE_OFFSET);
+    }
+    LeafLayout get_leaf_layout()
+    {
+        uint8_t value = *((uint8_t *)((char *)node + NODE_LEAF_LAYOUT_OFFSET));
+        return (LeafLayout)value;
+    }
+    void set_leaf_layout(LeafLayout layout)
+    {
+        *((uint8_t *)((char *)node + NODE_LEAF_LAYOUT_OFFSET)) = (uint8_t)layout;
+    }
+    uint64_t *node_lsn()
+    {
+        return (uint64_t *)((char *)node + NODE_LSN_OFFSET);
+    }
+    uint32_t *node_version()
+    {
+        return (uint32_t *)((char *)node + NODE_VERSION_OFFSET);
+    }
+    uint32_t read_node_version()
+    {
+        return __atomic_load_n(node_version(), __ATOMIC_ACQUIRE);
+    }
+    bool validate_node_version(uint32_t version)
+    {
+        /* Order the reads of the node before re-reading its version */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(node_version(), __ATOMIC_RELAXED) == version;
+    }
+    uint64_t get_node_max_key();
+    uint32_t get_node_row_count();
+};
+/*
+ * Leaf Node Header Layout
+ */
+const uint32_t LEAF_NODE_NUM_CELLS_SIZE = sizeof(uint32_t);
+const uint32_t LEAF_NODE_NUM_CELLS_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t LEAF_NODE_NEXT_LEAF_SIZE = sizeof(uint32_t);
+const uint32_t LEAF_NODE_NEXT_LEAF_OFFSET =
+    LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NODE_NUM_CELLS_SIZE;
+const uint32_t LEAF_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE +
+                                       LEAF_NODE_NUM_CELLS_SIZE +
+                                       LEAF_NODE_NEXT_LEAF_SIZE;
+/*
+ * Leaf Node Body Layout
+ */
+const uint32_t LEAF_NODE_KEY_SIZE = sizeof(uint64_t);
+const uint32_t LEAF_NODE_KEY_OFFSET = 0;
+const uint32_t LEAF_NODE_VALUE_SIZE = ROW_SIZE;
+const uint32_t LEAF_NODE_VALUE_OFFSET =
+    LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE;
+const uint32_t LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
+/*
+ * PAX Leaf Node Body Layout
+ *
+ * The minipages of a PAX leaf hold room for as many cells as a row
+ * leaf of the same page size, so both layouts split alike. The id
+ * column is the key and is not stored twice.
+ */
+constexpr uint32_t leaf_node_pax_usernames_offset(uint32_t max_cells)
+{
+    return max_cells * LEAF_NODE_KEY_SIZE;
+}
+constexpr uint32_t leaf_node_pax_emails_offset(uint32_t max_cells)
+{
+    return leaf_node_pax_usernames_offset(max_cells) + max_cells * USERNAME_SIZE;
+}
+constexpr uint32_t leaf_node_space_for_cells(uint32_t page_size)
+{
+    return page_size - LEAF_NODE_HEADER_SIZE;
+}
+constexpr uint32_t leaf_node_max_cells(uint32_t page_size)
+{
+    return leaf_node_space_for_cells(page_size) / LEAF_NODE_CELL_SIZE;
+}
+/*
+ * Dictionary Leaf Node Body Layout
+ *
+ * The keys come first as in a PAX leaf, then a 16-bit code per cell
+ * for the username and for the email, then the two dictionaries:
+ * every distinct value of the column once, in the same slots as PAX
+ * minipages, and last the number of values in each. A dictionary has
+ * a slot per cell; once it is full, the values no cell uses anymore
+ * are dropped.
+ */
+const uint32_t LEAF_NODE_DICT_CODE_SIZE = sizeof(uint16_t);
+constexpr uint32_t leaf_node_dict_codes_offset(uint32_t max_cells, Column column)
+{
+    return max_cells * LEAF_NODE_KEY_SIZE + (column == COLUMN_EMAIL ? max_cells * LEAF_NODE_DICT_CODE_SIZE : 0);
+}
+constexpr uint32_t leaf_node_dict_values_offset(uint32_t max_cells, Column column)
+{
+    uint32_t usernames_offset = max_cells * (LEAF_NODE_KEY_SIZE + 2 * LEAF_NODE_DICT_CODE_SIZE);
+    return column == COLUMN_USERNAME ? usernames_offset : usernames_offset + max_cells * USERNAME_SIZE;
+}
+constexpr uint32_t leaf_node_dict_sizes_offset(uint32_t max_cells)
+{
+    return leaf_node_dict_values_offset(max_cells, COLUMN_EMAIL) + max_cells * EMAIL_SIZE;
+}
+static_assert(leaf_node_dict_sizes_offset(leaf_node_max_cells(MIN_PAGE_SIZE)) + 2 * LEAF_NODE_DICT_CODE_SIZE <=
+                  leaf_node_space_for_cells(MIN_PAGE_SIZE),
+              "a dictionary leaf must fit as many cells as a row leaf");
+static_assert(leaf_node_dict_sizes_offset(leaf_node_max_cells(MAX_PAGE_SIZE)) + 2 * LEAF_NODE_DICT_CODE_SIZE <=
+                  leaf_node_space_for_cells(MAX_PAGE_SIZE),
+              "a dictionary leaf must fit as many cells as a row leaf");
+constexpr uint32_t leaf_node_right_split_count(uint32_t page_size)
+{
+    return (leaf_node_max_cells(page_size) + 1) / 2;
+}
+constexpr uint32_t leaf_node_left_split_count(uint32_t page_size)
+{
+    return (leaf_node_max_cells(page_size) + 1) - leaf_node_right_split_count(page_size);
+}
+
+/*
+The leaf layout of each page size, known at compile time. Code that
+is instantiated per page size gets constant loop bounds it can unroll.
+*/
+template <uint32_t PageSize>
+struct LeafNodeLayout
+{
+    static_assert(is_valid_page_size(PageSize), "page size must be a power of two between 4K and 64K");
+
+    static constexpr uint32_t SPACE_FOR_CELLS = leaf_node_space_for_cells(PageSize);
+    static constexpr uint32_t MAX_CELLS = leaf_node_max_cells(PageSize);
+    static constexpr uint32_t RIGHT_SPLIT_COUNT = leaf_node_right_split_count(PageSize);
+    static constexpr uint32_t LEFT_SPLIT_COUNT = leaf_node_left_split_count(PageSize);
+    /* Largest power of two not above MAX_CELLS */
+    static constexpr uint32_t SEARCH_STEP = [] {
+        uint32_t step = 1;
+        while (step * 2 <= MAX_CELLS)
+        {
+            step *= 2;
+        }
+        return step;
+    }();
+};
+
+class LeafNode : public Node
+{
+private:
+    template <uint32_t Size>
+    static void copy_column(void *destination, const void *source, uint32_t count)
+    {
+        /* A constant size lets the compiler inline every copy */
+        for (uint32_t i = 0; i < count; i++)
+        {
+            memcpy((char *)destination + i * Size, (const char *)source + i * LEAF_NODE_CELL_SIZE, Size);
+        }
+    }
+    template <uint32_t Size>
+    void copy_cells(void *destination, Column column, const uint32_t *cells, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            memcpy((char *)destination + i * Size, leaf_node_column(cells[i], column), Size);
+        }
+    }
+    void compact_dict(Column column, uint32_t skip_cell)
+    {
+        /*
+        Drop the values no cell uses, moving the others down and
+        renumbering the codes. Cells from num_cells on are free, and
+        skip_cell is about to take a new code.
+        */
+        uint16_t *codes = leaf_node_dict_codes(column);
+        uint16_t *size = leaf_node_dict_size(column);
+        uint32_t num_cells = *leaf_node_num_cells();
+        std::vector<uint16_t> new_codes(*size, UINT16_MAX);
+        for (uint32_t i = 0; i < num_cells; i++)
+        {
+            if (i != skip_cell)
+            {
+                new_codes[codes[i]] = 0;
+            }
+        }
+        uint16_t next_code = 0;
+        for (uint16_t code = 0; code < *size; code++)
+        {
+            if (new_codes[code] == UINT16_MAX)
+            {
+                continue;
+            }
+            if (next_code != code)
+            {
+                memcpy(leaf_node_dict_value(column, next_code), leaf_node_dict_value(column, code), column_size(column));
+            }
+            new_codes[code] = next_code++;
+        }
+        for (uint32_t i = 0; i < num_cells; i++)
+        {
+            if (i != skip_cell)
+            {
+                codes[i] = new_codes[codes[i]];
+            }
+        }
+        *size = next_code;
+    }
+
+public:
+    LeafNode() {}
+    LeafNode(void *node) : Node(node) {}
+
+    void initialize_leaf_node(uint32_t page_size, LeafLayout layout = LEAF_LAYOUT_ROWS)
+    {
+        *node_page_size() = page_size;
+        set_node_type(NODE_LEAF);
+        set_node_root(false);
+        set_leaf_layout(layout);
+        *leaf_node_num_cells() = 0;
+        *leaf_node_next_leaf() = 0; // 0 represents no sibling
+        if (layout == LEAF_LAYOUT_DICT)
+        {
+            *leaf_node_dict_size(COLUMN_USERNAME) = 0;
+            *leaf_node_dict_size(COLUMN_EMAIL) = 0;
+        }
+    }
+    uint32_t leaf_node_max_cells()
+    {
+        return ::leaf_node_max_cells(*node_page_size());
+    }
+    uint32_t *leaf_node_num_cells()
+    {
+        return (uint32_t *)((char *)node + LEAF_NODE_NUM_CELLS_OFFSET);
+    }
+    uint32_t leaf_node_key_stride()
+    {
+        /* Keys are one cell apart in a row leaf and contiguous in the others */
+        return get_leaf_layout() == LEAF_LAYOUT_ROWS ? LEAF_NODE_CELL_SIZE : LEAF_NODE_KEY_SIZE;
+    }
+    uint64_t *leaf_node_key(uint32_t cell_num)
+    {
+        return (uint64_t *)((char *)node + LEAF_NODE_HEADER_SIZE + cell_num * leaf_node_key_stride());
+    }
+    void *leaf_node_column(uint32_t cell_num, Column column)
+    {
+        /* Where the value of the column is stored for the cell, in either layout */
+        char *body = (char *)node + LEAF_NODE_HEADER_SIZE;
+        if (get_leaf_layout() == LEAF_LAYOUT_ROWS)
+        {
+            char *value = body + cell_num * LEAF_NODE_CELL_SIZE + LEAF_NODE_KEY_SIZE;
+            uint32_t offsets[NUM_COLUMNS] = {ID_OFFSET, USERNAME_OFFSET, EMAIL_OFFSET};
+            return value + offsets[column];
+        }
+        uint32_t max_cells = leaf_node_max_cells();
+        if (column != COLUMN_ID && get_leaf_layout() == LEAF_LAYOUT_DICT)
+        {
+            return leaf_node_dict_value(column, leaf_node_dict_codes(column)[cell_num]);
+        }
+        switch (column)
+        {
+        case COLUMN_ID:
+            return leaf_node_key(cell_num);
+        case COLUMN_USERNAME:
+            return body + leaf_node_pax_usernames_offset(max_cells) + cell_num * USERNAME_SIZE;
+        default:
+            return body + leaf_node_pax_emails_offset(max_cells) + cell_num * EMAIL_SIZE;
+        }
+    }
+    uint16_t *leaf_node_dict_codes(Column column)
+    {
+        return (uint16_t *)((char *)node + LEAF_NODE_HEADER_SIZE + leaf_node_dict_codes_offset(leaf_node_max_cells(), column));
+    }
+    char *leaf_node_dict_value(Column column, uint16_t code)
+    {
+        uint32_t offset = leaf_node_dict_values_offset(leaf_node_max_cells(), column);
+        return (char *)node + LEAF_NODE_HEADER_SIZE + offset + code * column_size(column);
+    }
+    uint16_t *leaf_node_dict_size(Column column)
+    {
+        uint16_t *sizes = (uint16_t *)((char *)node + LEAF_NODE_HEADER_SIZE + leaf_node_dict_sizes_offset(leaf_node_max_cells()));
+        return column == COLUMN_USERNAME ? sizes : sizes + 1;
+    }
+    uint16_t leaf_node_dict_find(Column column, std::string_view value)
+    {
+        /* The code of value in the column's dictionary, or its size if it is not there */
+        uint16_t size = *leaf_node_dict_size(column);
+        for (uint16_t code = 0; code < size; code++)
+        {
+            if (stored_string(leaf_node_dict_value(column, code)) == value)
+            {
+                return code;
+            }
+        }
+        return size;
+    }
+    uint16_t leaf_node_dict_code(Column column, std::string_view value, uint32_t cell_num)
+    {
+        /* The code of value for cell_num, adding value to the dictionary if it is new */
+        uint16_t code = leaf_node_dict_find(column, value);
+        if (code < *leaf_node_dict_size(column))
+        {
+            return code;
+        }
+        if (code == leaf_node_max_cells())
+        {
+            compact_dict(column, cell_num);
+        }
+        code = (*leaf_node_dict_size(column))++;
+        char *stored_value = leaf_node_dict_value(column, code);
+        stored_value[0] = (char)value.size();
+        memcpy(stored_value + 1, value.data(), value.size());
+        return code;
+    }
+    uint32_t leaf_node_filter(uint32_t cell_num, uint32_t count, Column column, std::string_view value, bool prefix,
+                              uint32_t *cells)
+    {
+        /*
+        Collect the cells from cell_num on, at most count, whose string
+        column equals value or starts with it. Stored strings are read as
+        string_views without their length byte and compared with value
+        as they are. A dictionary leaf matches the values of its
+        dictionary once, then only compares codes.
+        Every position is written and the count only advances on a
+        match, which keeps the loops free of branches.
+        */
+        uint32_t num_matches = 0;
+        if (get_leaf_layout() != LEAF_LAYOUT_DICT)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::string_view stored_value = stored_string((const char *)leaf_node_column(cell_num + i, column));
+                cells[num_matches] = cell_num + i;
+                num_matches += prefix ? stored_value.substr(0, value.size()) == value : stored_value == value;
+            }
+            return num_matches;
+        }
+        uint16_t *codes = leaf_node_dict_codes(column) + cell_num;
+        if (!prefix)
+        {
+            uint16_t code = leaf_node_dict_find(column, value);
+            if (code == *leaf_node_dict_size(column))
+            {
+                return 0;
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                cells[num_matches] = cell_num + i;
+                num_matches += codes[i] == code;
+            }
+            return num_matches;
+        }
+        uint16_t size = *leaf_node_dict_size(column);
+        std::vector<uint8_t> matches(size);
+        for (uint16_t code = 0; code < size; code++)
+        {
+            matches[code] = stored_string(leaf_node_dict_value(column, code)).substr(0, value.size()) == value;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            cells[num_matches] = cell_num + i;
+            num_matches += matches[codes[i]];
+        }
+        return num_matches;
+    }
+    RowView leaf_node_row(uint32_t cell_num)
+    {
+        return RowView(leaf_node_column(cell_num, COLUMN_ID),
+                       stored_string((char *)leaf_node_column(cell_num, COLUMN_USERNAME)),
+                       stored_string((char *)leaf_node_column(cell_num, COLUMN_EMAIL)));
+    }
+    void leaf_node_read_row(uint32_t cell_num, Row &row, uint32_t columns = ALL_COLUMNS)
+    {
+        /* Copy the given columns of the cell's row into row */
+        if (columns & column_mask(COLUMN_ID))
+        {
+            memcpy(&row.id, leaf_node_column(cell_num, COLUMN_ID), ID_SIZE);
+        }
+        if (columns & column_mask(COLUMN_USERNAME))
+        {
+            deserialize_string((char *)leaf_node_column(cell_num, COLUMN_USERNAME), row.username);
+        }
+        if (columns & column_mask(COLUMN_EMAIL))
+        {
+            deserialize_string((char *)leaf_node_column(cell_num, COLUMN_EMAIL), row.email);
+        }
+    }
+    void leaf_node_read_column(uint32_t cell_num, uint32_t count, Column column, void *destination)
+    {
+        /*
+        Copy the column of count cells from cell_num on into an array of
+        the column's values. A PAX minipage is already such an array.
+        */
+        const void *source = leaf_node_column(cell_num, column);
+        if (get_leaf_layout() == LEAF_LAYOUT_PAX || (get_leaf_layout() == LEAF_LAYOUT_DICT && column == COLUMN_ID))
+        {
+            memcpy(destination, source, count * column_size(column));
+            return;
+        }
+        if (get_leaf_layout() == LEAF_LAYOUT_DICT)
+        {
+            std::vector<uint32_t> cells(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                cells[i] = cell_num + i;
+            }
+            leaf_node_read_cells(cells.data(), count, column, destination);
+            return;
+        }
+        switch (column)
+        {
+        case COLUMN_ID:
+            copy_column<ID_SIZE>(destination, source, count);
+            break;
+        case COLUMN_USERNAME:
+            copy_column<USERNAME_SIZE>(destination, source, count);
+            break;
+        default:
+            copy_column<EMAIL_SIZE>(destination, source, count);
+        }
+    }
+    void leaf_node_read_cells(const uint32_t *cells, uint32_t count, Column column, void *destination)
+    {
+        /* Like leaf_node_read_column, for the given cells of any layout */
+        switch (column)
+        {
+        case COLUMN_ID:
+            copy_cells<ID_SIZE>(destination, column, cells, count);
+            break;
+        case COLUMN_USERNAME:
+            copy_cells<USERNAME_SIZE>(destination, column, cells, count);
+            break;
+        default:
+            copy_cells<EMAIL_SIZE>(destination, column, cells, count);
+        }
+    }
+    void leaf_node_write_cell(uint32_t cell_num, uint64_t key, Row &row)
+    {
+        *leaf_node_key(cell_num) = key;
+        if (get_leaf_layout() == LEAF_LAYOUT_ROWS)
+        {
+            serialize_row(row, leaf_node_column(cell_num, COLUMN_ID));
+            return;
+        }
+        if (get_leaf_layout() == LEAF_LAYOUT_DICT)
+        {
+            std::string_view username(row.username, strnlen(row.username, COLUMN_USERNAME_SIZE));
+            std::string_view email(row.email, strnlen(row.email, COLUMN_EMAIL_SIZE));
+            leaf_node_dict_codes(COLUMN_USERNAME)[cell_num] = leaf_node_dict_code(COLUMN_USERNAME, username, cell_num);
+            leaf_node_dict_codes(COLUMN_EMAIL)[cell_num] = leaf_node_dict_code(COLUMN_EMAIL, email, cell_num);
+            return;
+        }
+        serialize_string(row.username, COLUMN_USERNAME_SIZE, (char *)leaf_node_column(cell_num, COLUMN_USERNAME));
+        serialize_string(row.email, COLUMN_EMAIL_SIZE, (char *)leaf_node_column(cell_num, COLUMN_EMAIL));
+    }
+    void leaf_node_copy_cell(uint32_t cell_num, LeafNode source, uint32_t source_cell_num)
+    {
+        /* Both leaves have the same layout */
+        if (get_leaf_layout() == LEAF_LAYOUT_ROWS)
+        {
+            memcpy(leaf_node_key(cell_num), source.leaf_node_key(source_cell_num), LEAF_NODE_CELL_SIZE);
+            return;
+        }
+        *leaf_node_key(cell_num) = *source.leaf_node_key(source_cell_num);
+        if (get_leaf_layout() == LEAF_LAYOUT_DICT)
+        {
+            /* Within a leaf the codes stay valid, another leaf has its own dictionary */
+            for (Column column : {COLUMN_USERNAME, COLUMN_EMAIL})
+            {
+                uint16_t code = source.leaf_node_dict_codes(column)[source_cell_num];
+                if (source.get_node() != get_node())
+                {
+                    code = leaf_node_dict_code(column, stored_string(source.leaf_node_dict_value(column, code)), cell_num);
+                }
+                leaf_node_dict_codes(column)[cell_num] = code;
+            }
+            return;
+        }
+        memcpy(leaf_node_column(cell_num, COLUMN_USERNAME), source.leaf_node_column(source_cell_num, COLUMN_USERNAME),
+               USERNAME_SIZE);
+        memcpy(leaf_node_column(cell_num, COLUMN_EMAIL), source.leaf_node_column(source_cell_num, COLUMN_EMAIL),
+               EMAIL_SIZE);
+    }
+    uint32_t get_node_row_count()
+    {
+        return *leaf_node_num_cells();
+    }
+    uint64_t get_node_max_key()
+    {
+        return *leaf_node_key(*leaf_node_num_cells() - 1);
+    }
+    template <uint32_t PageSize>
+    uint32_t leaf_node_search(uint64_t key, uint32_t num_cells)
+    {
+        /*
+        Count the cells with a smaller key. The steps only depend on
+        the page size, so the loop is unrolled into a fixed number of
+        branch-free compare and add steps.
+        */
+        const char *keys = (char *)leaf_node_key(0);
+        uint32_t stride = leaf_node_key_stride();
+        uint32_t index = 0;
+        for (uint32_t step = LeafNodeLayout<PageSize>::SEARCH_STEP; step > 0; step /= 2)
+        {
+            uint32_t next = index + step;
+            index = (next <= num_cells && *(const uint64_t *)(keys + (next - 1) * stride) < key) ? next : index;
+        }
+        return index;
+    }
+    uint32_t leaf_node_find_cell(uint64_t key, uint32_t num_cells)
+    {
+        /*
+        Return the index of the cell holding the key, or the
+        position where it would have to be inserted.
+        */
+        switch (*node_page_size())
+        {
+        case 4096:
+            return leaf_node_search<4096>(key, num_cells);
+        case 8192:
+            return leaf_node_search<8192>(key, num_cells);
+        case 16384:
+            return leaf_node_search<16384>(key, num_cells);
+        case 32768:
+            return leaf_node_search<32768>(key, num_cells);
+        case 65536:
+            return leaf_node_search<65536>(key, num_cells);
+        }
+
+        // Binary search
+        uint32_t min_index = 0;
+        uint32_t one_past_max_index = num_cells;
+        while (one_past_max_index != min_index)
+        {
+            uint32_t index = (min_index + one_past_max_index) / 2;
+            uint64_t key_at_index = *leaf_node_key(index);
+            if (key == key_at_index)
+            {
+                return index;
+            }
+            if (key < key_at_index)
+            {
+                one_past_max_index = index;
+            }
+            else
+            {
+                min_index = index + 1;
+            }
+        }
+
+        return min_index;
+    }
+    u_int32_t *leaf_node_next_leaf()
+    {
+        return (u_int32_t *)((char *)node + LEAF_NODE_NEXT_LEAF_OFFSET);
+    }
+};
+
+/*
+ * Internal Node Header Layout
+ *
+ * Every child pointer comes with the number of rows in the child's
+ * subtree, so rows can be counted and found by position without
+ * visiting the leaves.
+ */
+const uint32_t INTERNAL_NODE_NUM_KEYS_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_NUM_KEYS_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t INTERNAL_NODE_RIGHT_CHILD_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_RIGHT_CHILD_OFFSET =
+    INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE;
+const uint32_t INTERNAL_NODE_RIGHT_CHILD_ROW_COUNT_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_RIGHT_CHILD_ROW_COUNT_OFFSET =
+    INTERNAL_NODE_RIGHT_CHILD_OFFSET + INTERNAL_NODE_RIGHT_CHILD_SIZE;
+const uint32_t INTERNAL_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE +
+                                           INTERNAL_NODE_NUM_KEYS_SIZE +
+                                           INTERNAL_NODE_RIGHT_CHILD_SIZE +
+                                           INTERNAL_NODE_RIGHT_CHILD_ROW_COUNT_SIZE;
+/*
+ * Internal Node Body Layout
+ */
+const uint32_t INTERNAL_NODE_KEY_SIZE = sizeof(uint64_t);
+const uint32_t INTERNAL_NODE_CHILD_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_ROW_COUNT_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_CELL_SIZE =
+    INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_SIZE + INTERNAL_NODE_ROW_COUNT_SIZE;
+/* Keep this small for testing */
+const uint32_t INTERNAL_NODE_MAX_CELLS = 3;
+
+class InternalNode : public Node
+{
+public:
+    InternalNode() {}
+    InternalNode(void *node) : Node(node) {}
+
+    void initialize_internal_node(uint32_t page_size)
+    {
+        *node_page_size() = page_size;
+        set_node_type(NODE_INTERNAL);
+        set_node_root(false);
+        *internal_node_num_keys() = 0;
+        *internal_node_right_child_row_count() = 0;
+    }
+    uint32_t *internal_node_num_keys()
+    {
+        return (uint32_t *)((char *)node + INTERNAL_NODE_NUM_KEYS_OFFSET);
+    }
+    u_int32_t *internal_node_right_child()
+    {
+        return (u_int32_t *)((char *)node + INTERNAL_NODE_RIGHT_CHILD_OFFSET);
+    }
+    uint32_t *internal_node_right_child_row_count()
+    {
+        return (uint32_t *)((char *)node + INTERNAL_NODE_RIGHT_CHILD_ROW_COUNT_OFFSET);
+    }
+    uint32_t *internal_node_cell(uint32_t cell_num)
+    {
+        return (uint32_t *)((char *)node + INTERNAL_NODE_HEADER_SIZE + cell_num * INTERNAL_NODE_CELL_SIZE);
+    }
+    uint32_t *internal_node_child(uint32_t child_num)
+    {
+        uint32_t num_keys = *internal_node_num_keys();
+        if (child_num > num_keys)
+        {
+            std::cout << "Tried to access child_num " << child_num << " > num_keys " << num_keys << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        else if (child_num == num_keys)
+        {
+            return internal_node_right_child();
+        }
+        else
+        {
+            return internal_node_cell(child_num);
+        }
+    }
+    uint64_t *internal_node_key(uint32_t key_num)
+    {
+        return (uint64_t *)((char *)internal_node_cell(key_num) + INTERNAL_NODE_CHILD_SIZE);
+    }
+    uint32_t *internal_node_row_count(uint32_t child_num)
+    {
+        /* Rows in the subtree of the child */
+        uint32_t num_keys = *internal_node_num_keys();
+        if (child_num == num_keys)
+        {
+            return internal_node_right_child_row_count();
+        }
+        return (uint32_t *)((char *)internal_node_key(child_num) + INTERNAL_NODE_KEY_SIZE);
+    }
+    uint32_t get_node_row_count()
+    {
+        uint32_t num_keys = *internal_node_num_keys();
+        uint32_t row_count = *internal_node_right_child_row_count();
+        for (uint32_t i = 0; i < num_keys; i++)
+        {
+            row_count += *internal_node_row_count(i);
+        }
+        return row_count;
+    }
+    uint64_t get_node_max_key()
+    {
+        return *internal_node_key(*internal_node_num_keys() - 1);
+    }
+    uint32_t internal_node_find_child(uint64_t key)
+    {
+        return internal_node_find_child(key, *internal_node_num_keys());
+    }
+    uint32_t internal_node_find_child(uint64_t key, uint32_t num_keys)
+    {
+        /*
+        Return the index of the child which should contain
+        the given key.
+        */
+
+        /* Binary search */
+        uint32_t min_index = 0;
+        uint32_t max_index = num_keys; /* there is one more child than key */
+
+        while (min_index != max_index)
+        {
+            uint32_t index = (min_index + max_index) / 2;
+            uint64_t key_to_right = *internal_node_key(index);
+            if (key_to_right >= key)
+            {
+                max_index = index;
+            }
+            else
+            {
+                min_index = index + 1;
+            }
+        }
+
+        return min_index;
+    }
+    void update_internal_node_key(uint64_t old_key, uint64_t new_key)
+    {
+        uint32_t old_child_index = internal_node_find_child(old_key);
+        *internal_node_key(old_child_index) = new_key;
+    }
+};
+inline uint64_t Node::get_node_max_key()
+{
+    /* A node of unknown type dispatches on the type stored in its page */
+    if (get_node_type() == NODE_LEAF)
+    {
+        return LeafNode(node).get_node_max_key();
+    }
+    else
+    {
+        return InternalNode(node).get_node_max_key();
+    }
+}
+inline uint32_t Node::get_node_row_count()
+{
+    if (get_node_type() == NODE_LEAF)
+    {
+        return LeafNode(node).get_node_row_count();
+    }
+    else
+    {
+        return InternalNode(node).get_node_row_count();
+    }
+}
+
+#endif
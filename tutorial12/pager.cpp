@@ -0,0 +1,837 @@
+#include <algorithm>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pager.h"
+
+Pager::Pager(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression)
+    : wal(filename)
+{
+    file_descriptor = open(filename,
+                           O_RDWR |     // Read/Write mode
+                               O_CREAT, // Create file if it does not exist
+                           S_IWUSR |    // User write permission
+                               S_IRUSR  // User read permission
+    );
+    if (file_descriptor < 0)
+    {
+        std::cerr << "Error: cannot open file " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    file_length = lseek(file_descriptor, 0, SEEK_END);
+    if (file_length == 0)
+    {
+        // New file. Page 0 describes the database, the tree starts at page 1.
+        if (!is_valid_page_size(page_size))
+        {
+            std::cerr << "Error: page size must be a power of two between "
+                      << MIN_PAGE_SIZE << " and " << MAX_PAGE_SIZE << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        this->page_size = page_size;
+        header = malloc(page_size);
+        HeaderPage(header).initialize_header_page(1, page_size, layout, compression);
+        write_header();
+    }
+    else
+    {
+        /* The header fits in the smallest page, which tells the page size */
+        header = malloc(MIN_PAGE_SIZE);
+        HeaderPage header_page = header;
+        ssize_t bytes_read = pread(file_descriptor, header, MIN_PAGE_SIZE, 0);
+        if (bytes_read != MIN_PAGE_SIZE || !header_page.has_magic())
+        {
+            std::cerr << "Error: " << filename << " is not a database file." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (*header_page.header_format_version() != DB_FORMAT_VERSION)
+        {
+            std::cerr << "Error: unsupported database format version "
+                      << *header_page.header_format_version() << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        this->page_size = *header_page.header_page_size();
+        if (!is_valid_page_size(this->page_size) ||
+            *header_page.header_row_size() != ROW_SIZE ||
+            *header_page.header_leaf_node_max_cells() != leaf_node_max_cells(this->page_size) ||
+            *header_page.header_leaf_layout() > LEAF_LAYOUT_DICT ||
+            *header_page.header_compression() > PAGE_COMPRESSION_LZ)
+        {
+            std::cerr << "Error: database was created with a different page layout." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        header = realloc(header, this->page_size);
+        memset((char *)header + MIN_PAGE_SIZE, 0, this->page_size - MIN_PAGE_SIZE);
+    }
+    writeback_image = malloc(this->page_size);
+    HeaderPage header_page = header;
+    this->compression = (PageCompression)*header_page.header_compression();
+    if (this->compression != PAGE_COMPRESSION_NONE)
+    {
+        load_extents();
+    }
+
+    /* Redo the commits that had not reached the db file before a crash */
+    num_pages = *header_page.header_page_count();
+    last_commit_ts = wal.recover(
+        this->page_size, *header_page.header_checkpoint_lsn(), *header_page.header_checkpoint_offset(), num_pages,
+        [this](uint32_t page_num, uint64_t lsn, const char *image)
+        { replay_page(page_num, lsn, image); },
+        [this, header_page](uint64_t redo_lsn) mutable
+        {
+            /* The log is truncated next, so recovery starts at its beginning */
+            *header_page.header_checkpoint_lsn() = redo_lsn;
+            *header_page.header_checkpoint_offset() = 0;
+            write_header();
+        });
+
+    file_length = lseek(file_descriptor, 0, SEEK_END);
+    if (this->compression == PAGE_COMPRESSION_NONE && file_length % this->page_size != 0)
+    {
+        std::cerr << "Db file is not a whole number of pages. Corrupt file." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    {
+        pages[i] = nullptr;
+        page_ts[i] = 0;
+        dirty[i] = false;
+    }
+    writeback_stopping = false;
+}
+uint32_t Pager::get_page_size()
+{
+    return page_size;
+}
+LeafLayout Pager::get_leaf_layout()
+{
+    return (LeafLayout)*HeaderPage(header).header_leaf_layout();
+}
+void *Pager::get_page(uint32_t page_num)
+{
+    if (page_num >= TABLE_MAX_PAGES)
+    {
+        std::cout << "Tried to fetch page number out of bounds. " << page_num << " > "
+                  << TABLE_MAX_PAGES << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    void *cached_page = pages[page_num].load(std::memory_order_acquire);
+    if (cached_page != nullptr)
+    {
+        return cached_page;
+    }
+
+    std::lock_guard<std::mutex> guard(page_table_mutex);
+    if (pages[page_num] == nullptr)
+    {
+        // Cache miss. Allocate memory and load from file.
+        void *page = malloc(page_size);
+        read_page(page_num, page);
+
+        /* Versions only order writers against readers in memory */
+        *Node(page).node_version() = 0;
+        pages[page_num].store(page, std::memory_order_release);
+
+        if (page_num >= this->num_pages)
+        {
+            this->num_pages = page_num + 1;
+        }
+    }
+
+    return pages[page_num];
+}
+void Pager::latch_page(uint32_t page_num, LatchMode mode)
+{
+    if (mode == LATCH_SHARED)
+    {
+        latches[page_num].lock_shared();
+    }
+    else
+    {
+        latches[page_num].lock();
+        /* Odd version: optimistic readers must not trust the page */
+        __atomic_fetch_add(Node(get_page(page_num)).node_version(), 1, __ATOMIC_ACQ_REL);
+    }
+}
+bool Pager::try_latch_page(uint32_t page_num, LatchMode mode)
+{
+    /* Like latch_page, but gives up instead of waiting for another holder */
+    if (mode == LATCH_SHARED)
+    {
+        return latches[page_num].try_lock_shared();
+    }
+    if (!latches[page_num].try_lock())
+    {
+        return false;
+    }
+    __atomic_fetch_add(Node(get_page(page_num)).node_version(), 1, __ATOMIC_ACQ_REL);
+    return true;
+}
+void Pager::unlatch_page(uint32_t page_num, LatchMode mode)
+{
+    if (mode == LATCH_SHARED)
+    {
+        latches[page_num].unlock_shared();
+    }
+    else
+    {
+        __atomic_fetch_add(Node(get_page(page_num)).node_version(), 1, __ATOMIC_RELEASE);
+        latches[page_num].unlock();
+    }
+}
+void Pager::read_page(uint32_t page_num, void *page)
+{
+    /* Pages the file does not have yet start out zeroed */
+    memset(page, 0, page_size);
+    if (compression == PAGE_COMPRESSION_NONE)
+    {
+        uint32_t num_pages = file_length / page_size;
+
+        // We might save a partial page at the end of the file
+        if (file_length % page_size)
+        {
+            num_pages += 1;
+        }
+
+        if (page_num <= num_pages)
+        {
+            ssize_t bytes_read = pread(file_descriptor, page, page_size, (off_t)page_num * page_size);
+            if (bytes_read == -1)
+            {
+                std::cout << "Error reading file: " << errno << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(extent_mutex);
+    HeaderPage header_page = header;
+    uint32_t sector = *header_page.header_extent_sector(page_num);
+    uint32_t size = *header_page.header_extent_size(page_num);
+    if (sector == 0)
+    {
+        return;
+    }
+    void *extent = size == page_size ? page : malloc(size);
+    ssize_t bytes_read = pread(file_descriptor, extent, size, (off_t)sector * EXTENT_SECTOR_SIZE);
+    if (bytes_read == -1)
+    {
+        std::cout << "Error reading file: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (extent != page)
+    {
+        bool valid = bytes_read == size && lz_decompress(extent, size, page, page_size);
+        free(extent);
+        if (!valid)
+        {
+            std::cout << "Page " << page_num << " does not decompress. Corrupt file." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+void Pager::replay_page(uint32_t page_num, uint64_t lsn, const char *image)
+{
+    /*
+    Called by recovery, from several threads. Skip the page if the
+    file already has this commit or a later one. An extent of a
+    compressed database may have been taken over by another page
+    since the header was written, so those pages are always written.
+    */
+    if (compression == PAGE_COMPRESSION_NONE)
+    {
+        char node_header[COMMON_NODE_HEADER_SIZE];
+        ssize_t bytes_read = pread(file_descriptor, node_header, COMMON_NODE_HEADER_SIZE, (off_t)page_num * page_size);
+        if (bytes_read == COMMON_NODE_HEADER_SIZE && *Node(node_header).node_lsn() >= lsn)
+        {
+            return;
+        }
+    }
+    pager_flush(page_num, (void *)image);
+}
+void Pager::pager_flush(uint32_t page_num, void *image)
+{
+    /* pwrite leaves the file offset alone, get_page may be reading */
+    if (compression == PAGE_COMPRESSION_NONE)
+    {
+        ssize_t bytes_written = pwrite(file_descriptor, image, page_size, (off_t)page_num * page_size);
+        if (bytes_written == -1)
+        {
+            std::cout << "Error writing: " << errno << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    /* Pages that do not compress are stored as they are */
+    void *compressed = malloc(page_size);
+    uint32_t size = lz_compress(image, page_size, compressed, page_size - 1);
+    const void *extent = compressed;
+    if (size == 0)
+    {
+        size = page_size;
+        extent = image;
+    }
+    {
+        /* Written under the mutex, so a header written meanwhile never maps an unwritten extent */
+        std::lock_guard<std::mutex> guard(extent_mutex);
+        uint32_t sector = place_extent(page_num, size);
+        ssize_t bytes_written = pwrite(file_descriptor, extent, size, (off_t)sector * EXTENT_SECTOR_SIZE);
+        if (bytes_written == -1)
+        {
+            std::cout << "Error writing: " << errno << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(compressed);
+}
+static uint32_t sectors_for(uint32_t size)
+{
+    return (size + EXTENT_SECTOR_SIZE - 1) / EXTENT_SECTOR_SIZE;
+}
+void Pager::load_extents()
+{
+    /* Everything between the header and the end of the file that no page maps is free */
+    HeaderPage header_page = header;
+    std::vector<std::pair<uint32_t, uint32_t>> extents;
+    for (uint32_t i = 1; i < TABLE_MAX_PAGES; i++)
+    {
+        uint32_t sector = *header_page.header_extent_sector(i);
+        if (sector != 0)
+        {
+            extents.push_back(std::make_pair(sector, sectors_for(*header_page.header_extent_size(i))));
+        }
+    }
+    std::sort(extents.begin(), extents.end());
+    end_sector = page_size / EXTENT_SECTOR_SIZE;
+    for (auto &extent : extents)
+    {
+        if (extent.first > end_sector)
+        {
+            free_extents[end_sector] = extent.first - end_sector;
+        }
+        end_sector = std::max(end_sector, extent.first + extent.second);
+    }
+}
+uint32_t Pager::place_extent(uint32_t page_num, uint32_t size)
+{
+    /*
+    Find the first sector for the page's new image and map the page
+    to it. Called with extent_mutex held.
+    */
+    HeaderPage header_page = header;
+    uint32_t sector = *header_page.header_extent_sector(page_num);
+    uint32_t num_sectors = sectors_for(size);
+    uint32_t old_num_sectors = sectors_for(*header_page.header_extent_size(page_num));
+    if (sector != 0 && num_sectors <= old_num_sectors)
+    {
+        /* Rewrite the page in place, recovery redoes it if it is torn */
+        if (num_sectors < old_num_sectors)
+        {
+            released_extents.push_back(std::make_pair(sector + num_sectors, old_num_sectors - num_sectors));
+        }
+    }
+    else
+    {
+        if (sector != 0)
+        {
+            released_extents.push_back(std::make_pair(sector, old_num_sectors));
+        }
+        /* First fit, or grow the file */
+        auto free_extent = free_extents.begin();
+        while (free_extent != free_extents.end() && free_extent->second < num_sectors)
+        {
+            free_extent++;
+        }
+        if (free_extent == free_extents.end())
+        {
+            sector = end_sector;
+            end_sector += num_sectors;
+        }
+        else
+        {
+            sector = free_extent->first;
+            if (free_extent->second > num_sectors)
+            {
+                free_extents[sector + num_sectors] = free_extent->second - num_sectors;
+            }
+            free_extents.erase(free_extent);
+        }
+    }
+    *header_page.header_extent_sector(page_num) = sector;
+    *header_page.header_extent_size(page_num) = size;
+    return sector;
+}
+void Pager::free_extent(uint32_t sector, uint32_t num_sectors)
+{
+    /* Merge with the free neighbours. Called with extent_mutex held. */
+    auto next = free_extents.lower_bound(sector);
+    if (next != free_extents.end() && next->first == sector + num_sectors)
+    {
+        num_sectors += next->second;
+        next = free_extents.erase(next);
+    }
+    if (next != free_extents.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == sector)
+        {
+            previous->second += num_sectors;
+            return;
+        }
+    }
+    free_extents[sector] = num_sectors;
+}
+static void indent(uint32_t level)
+{
+    for (uint32_t i = 0; i < level; i++)
+    {
+        std::cout << "  ";
+    }
+}
+void Pager::print_tree(uint32_t page_num, uint32_t indentation_level)
+{
+    Node node = get_page(page_num);
+    uint32_t num_keys, child;
+
+    switch (node.get_node_type())
+    {
+    case (NODE_LEAF):
+    {
+        LeafNode leaf_node = node.get_node();
+        num_keys = *leaf_node.leaf_node_num_cells();
+        indent(indentation_level);
+        std::cout << "- leaf (size " << num_keys << ")" << std::endl;
+        for (uint32_t i = 0; i < num_keys; i++)
+        {
+            indent(indentation_level + 1);
+            std::cout << "- " << *leaf_node.leaf_node_key(i) << std::endl;
+        }
+        break;
+    }
+    case (NODE_INTERNAL):
+    {
+        InternalNode internal_node = node.get_node();
+        num_keys = *internal_node.internal_node_num_keys();
+        indent(indentation_level);
+        std::cout << "- internal (size " << num_keys << ")" << std::endl;
+        for (uint32_t i = 0; i < num_keys; i++)
+        {
+            child = *internal_node.internal_node_child(i);
+            print_tree(child, indentation_level + 1);
+
+            indent(indentation_level + 1);
+            std::cout << "- key " << *internal_node.internal_node_key(i) << std::endl;
+        }
+        child = *internal_node.internal_node_right_child();
+        print_tree(child, indentation_level + 1);
+        break;
+    }
+    }
+}
+/*
+Until we start recycling free pages, new pages will always
+go onto the end of the database file. The page is reserved
+right away so concurrent writers never get the same one.
+*/
+uint32_t Pager::get_unused_page_num()
+{
+    std::lock_guard<std::mutex> guard(page_table_mutex);
+    /* No snapshot can reach a new page before its writer commits */
+    if (num_pages < TABLE_MAX_PAGES)
+    {
+        page_ts[num_pages] = PAGE_TS_PENDING;
+    }
+    return num_pages++;
+}
+bool Pager::is_page_pending(uint32_t page_num)
+{
+    return page_ts[page_num] == PAGE_TS_PENDING;
+}
+void Pager::shadow_page(uint32_t page_num)
+{
+    /*
+    Called by a writer holding the page's exclusive latch
+    before its first change to the page.
+    */
+    std::lock_guard<std::mutex> guard(version_mutexes[page_num]);
+    if (page_ts[page_num] == PAGE_TS_PENDING)
+    {
+        return;
+    }
+
+    PageVersion version;
+    version.image = malloc(page_size);
+    memcpy(version.image, get_page(page_num), page_size);
+    version.ts_from = page_ts[page_num];
+    version.ts_to = PAGE_TS_PENDING;
+    page_versions[page_num].push_back(version);
+    page_ts[page_num] = PAGE_TS_PENDING;
+}
+void Pager::commit_pages(std::vector<uint32_t> &page_nums, bool sync)
+{
+    /*
+    Called by a writer that still holds the exclusive latches of
+    all the pages it changed, or by a transaction, which excludes
+    all other writers.
+    */
+    std::lock_guard<std::mutex> commit_guard(commit_mutex);
+    uint64_t commit_ts = last_commit_ts + 1;
+
+    /* The commit is logged before any reader can see it */
+    for (uint32_t page_num : page_nums)
+    {
+        Node page = get_page(page_num);
+        *page.node_lsn() = commit_ts;
+        wal.append_page(page_num, page.get_node());
+    }
+    wal.append_commit(commit_ts, sync);
+
+    for (uint32_t page_num : page_nums)
+    {
+        std::lock_guard<std::mutex> guard(version_mutexes[page_num]);
+        if (!page_versions[page_num].empty() &&
+            page_versions[page_num].back().ts_to == PAGE_TS_PENDING)
+        {
+            page_versions[page_num].back().ts_to = commit_ts;
+        }
+        page_ts[page_num] = commit_ts;
+    }
+    last_commit_ts = commit_ts;
+
+    {
+        std::lock_guard<std::mutex> dirty_guard(dirty_mutex);
+        for (uint32_t page_num : page_nums)
+        {
+            if (!dirty[page_num])
+            {
+                dirty[page_num] = true;
+                dirty_lsn[page_num] = commit_ts;
+                dirty_since[page_num] = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    for (uint32_t page_num : page_nums)
+    {
+        reclaim_page_versions(page_num);
+    }
+}
+void Pager::rollback_pages(std::vector<uint32_t> &page_nums, uint32_t num_pages)
+{
+    /*
+    Undo the uncommitted changes of a transaction, which excludes all
+    other writers. Pages that existed before it are restored from the
+    image shadow_page saved, pages it allocated are given back by
+    resetting num_pages to its value when the transaction began.
+    */
+    for (uint32_t page_num : page_nums)
+    {
+        if (page_num >= num_pages)
+        {
+            continue;
+        }
+        latch_page(page_num, LATCH_EXCLUSIVE);
+        {
+            std::lock_guard<std::mutex> guard(version_mutexes[page_num]);
+            PageVersion &version = page_versions[page_num].back();
+            /* Keep the latched version, optimistic readers may be looking at it */
+            memcpy((char *)get_page(page_num) + NODE_TYPE_OFFSET, (char *)version.image + NODE_TYPE_OFFSET,
+                   page_size - NODE_TYPE_OFFSET);
+            page_ts[page_num] = version.ts_from;
+            free(version.image);
+            page_versions[page_num].pop_back();
+        }
+        unlatch_page(page_num, LATCH_EXCLUSIVE);
+    }
+
+    std::lock_guard<std::mutex> guard(page_table_mutex);
+    for (uint32_t page_num = num_pages; page_num < this->num_pages && page_num < TABLE_MAX_PAGES; page_num++)
+    {
+        page_ts[page_num] = 0;
+    }
+    this->num_pages = num_pages;
+}
+uint64_t Pager::begin_snapshot()
+{
+    std::lock_guard<std::mutex> guard(commit_mutex);
+    active_snapshots.insert(last_commit_ts);
+    return last_commit_ts;
+}
+void Pager::end_snapshot(uint64_t snapshot_ts)
+{
+    std::lock_guard<std::mutex> guard(commit_mutex);
+    active_snapshots.erase(active_snapshots.find(snapshot_ts));
+    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    {
+        reclaim_page_versions(i);
+    }
+}
+void Pager::reclaim_page_versions(uint32_t page_num)
+{
+    /*
+    Free every committed image that no active snapshot falls into.
+    Called with commit_mutex held.
+    */
+    std::lock_guard<std::mutex> guard(version_mutexes[page_num]);
+    std::vector<PageVersion> &versions = page_versions[page_num];
+    for (size_t i = 0; i < versions.size();)
+    {
+        auto reader = active_snapshots.lower_bound(versions[i].ts_from);
+        bool visible = versions[i].ts_to == PAGE_TS_PENDING ||
+                       (reader != active_snapshots.end() && *reader < versions[i].ts_to);
+        if (visible)
+        {
+            i++;
+            continue;
+        }
+        free(versions[i].image);
+        versions.erase(versions.begin() + i);
+    }
+}
+void Pager::read_page_version(uint32_t page_num, uint64_t snapshot_ts, void *destination)
+{
+    /*
+    Copy the page as of snapshot_ts. The current image is copied
+    optimistically and validated against the page version; if a
+    writer holds the page, fall back to the version mutex, which
+    writers must take before their first change to the page.
+    */
+    Node page = get_page(page_num);
+    uint32_t version = page.read_node_version();
+    if (!(version & 1) && page_ts[page_num] <= snapshot_ts)
+    {
+        memcpy(destination, page.get_node(), page_size);
+        if (page.validate_node_version(version))
+        {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(version_mutexes[page_num]);
+    if (page_ts[page_num] <= snapshot_ts)
+    {
+        memcpy(destination, page.get_node(), page_size);
+        return;
+    }
+    for (PageVersion &old_version : page_versions[page_num])
+    {
+        if (old_version.ts_from <= snapshot_ts && snapshot_ts < old_version.ts_to)
+        {
+            memcpy(destination, old_version.image, page_size);
+            return;
+        }
+    }
+    std::cout << "No version of page " << page_num << " for snapshot " << snapshot_ts << std::endl;
+    exit(EXIT_FAILURE);
+}
+void Pager::start_writeback()
+{
+    writeback_thread = std::thread(&Pager::writeback_loop, this);
+}
+void Pager::stop_writeback()
+{
+    {
+        std::lock_guard<std::mutex> guard(writeback_mutex);
+        writeback_stopping = true;
+    }
+    writeback_cv.notify_one();
+    if (writeback_thread.joinable())
+    {
+        writeback_thread.join();
+    }
+}
+void Pager::writeback_loop()
+{
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(writeback_mutex);
+    while (!writeback_cv.wait_for(lock, std::chrono::milliseconds(WRITEBACK_INTERVAL_MS),
+                                  [this]()
+                                  { return writeback_stopping; }))
+    {
+        lock.unlock();
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_checkpoint >= std::chrono::milliseconds(CHECKPOINT_INTERVAL_MS))
+        {
+            checkpoint();
+            last_checkpoint = now;
+        }
+        else
+        {
+            write_back_old_pages();
+        }
+        lock.lock();
+    }
+}
+bool Pager::write_back_page(uint32_t page_num)
+{
+    /*
+    Write the committed image of a page to the db file. A shared latch
+    keeps writers out while it is copied; pages that an uncommitted
+    transaction changed are left for later. Called with
+    writeback_image_mutex held.
+    */
+    void *image = writeback_image;
+
+    latch_page(page_num, LATCH_SHARED);
+    if (page_ts[page_num] == PAGE_TS_PENDING)
+    {
+        unlatch_page(page_num, LATCH_SHARED);
+        return false;
+    }
+    memcpy(image, get_page(page_num), page_size);
+    {
+        std::lock_guard<std::mutex> dirty_guard(dirty_mutex);
+        dirty[page_num] = false;
+    }
+    unlatch_page(page_num, LATCH_SHARED);
+
+    /* The log must have the page's last commit before the file does */
+    {
+        std::lock_guard<std::mutex> commit_guard(commit_mutex);
+        wal.sync_to(*Node(image).node_lsn());
+    }
+    pager_flush(page_num, image);
+    return true;
+}
+void Pager::write_back_old_pages()
+{
+    std::vector<std::pair<std::chrono::steady_clock::time_point, uint32_t>> dirty_pages;
+    {
+        std::lock_guard<std::mutex> dirty_guard(dirty_mutex);
+        for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+        {
+            if (dirty[i])
+            {
+                dirty_pages.push_back(std::make_pair(dirty_since[i], i));
+            }
+        }
+    }
+    std::sort(dirty_pages.begin(), dirty_pages.end());
+
+    /* Oldest first: everything past its age, and enough to get under the dirty limit */
+    auto max_dirty_since = std::chrono::steady_clock::now() - std::chrono::milliseconds(WRITEBACK_MAX_DIRTY_AGE_MS);
+    size_t max_dirty_pages = TABLE_MAX_PAGES * WRITEBACK_MAX_DIRTY_PERCENT / 100;
+    for (size_t i = 0; i < dirty_pages.size(); i++)
+    {
+        if (dirty_pages[i].first > max_dirty_since && dirty_pages.size() - i <= max_dirty_pages)
+        {
+            break;
+        }
+        std::lock_guard<std::mutex> image_guard(writeback_image_mutex);
+        write_back_page(dirty_pages[i].second);
+    }
+}
+void Pager::write_back_dirty_pages()
+{
+    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    {
+        bool is_dirty;
+        {
+            std::lock_guard<std::mutex> dirty_guard(dirty_mutex);
+            is_dirty = dirty[i];
+        }
+        if (is_dirty)
+        {
+            write_back_page(i);
+        }
+    }
+}
+void Pager::checkpoint()
+{
+    /*
+    Writers keep committing while the dirty pages are written back,
+    so afterwards the log may still be needed from the oldest commit
+    that dirtied a page again, or one that could not be written.
+
+    A page is no longer dirty once its image is copied, before it is
+    in the file. Holding writeback_image_mutex until the redo LSN is
+    logged keeps any other write-back from running in between, so
+    every page that is not dirty here is in the file at the fsync.
+    */
+    std::lock_guard<std::mutex> image_guard(writeback_image_mutex);
+    write_back_dirty_pages();
+    if (fsync(file_descriptor) == -1)
+    {
+        std::cout << "Error syncing db file: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::lock_guard<std::mutex> commit_guard(commit_mutex);
+    uint64_t redo_lsn = last_commit_ts + 1;
+    {
+        std::lock_guard<std::mutex> dirty_guard(dirty_mutex);
+        for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+        {
+            if (dirty[i] && dirty_lsn[i] < redo_lsn)
+            {
+                redo_lsn = dirty_lsn[i];
+            }
+        }
+    }
+
+    HeaderPage header_page = header;
+    {
+        std::lock_guard<std::mutex> guard(page_table_mutex);
+        *header_page.header_page_count() = num_pages;
+    }
+    /* If every commit is in the file, the log is truncated and starts over */
+    bool truncate = redo_lsn == last_commit_ts + 1;
+    *header_page.header_checkpoint_lsn() = redo_lsn;
+    *header_page.header_checkpoint_offset() = truncate ? 0 : wal.redo_offset(redo_lsn);
+    write_header();
+
+    wal.checkpoint(redo_lsn, truncate);
+}
+uint32_t Pager::get_index_root(Column column)
+{
+    std::lock_guard<std::mutex> commit_guard(commit_mutex);
+    return *HeaderPage(header).header_index_root(column);
+}
+void Pager::set_index_root(Column column, uint32_t root_page_num)
+{
+    /* Reaches the file with the next checkpoint, see Database::create_index */
+    std::lock_guard<std::mutex> commit_guard(commit_mutex);
+    *HeaderPage(header).header_index_root(column) = root_page_num;
+}
+void Pager::write_header()
+{
+    /* The header is never compressed, and maps only extents that are written */
+    std::lock_guard<std::mutex> guard(extent_mutex);
+    ssize_t bytes_written = pwrite(file_descriptor, header, page_size, 0);
+    if (bytes_written == -1)
+    {
+        std::cout << "Error writing: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (fsync(file_descriptor) == -1)
+    {
+        std::cout << "Error syncing db file: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    /* No page the header maps is in a released extent anymore */
+    for (auto &extent : released_extents)
+    {
+        free_extent(extent.first, extent.second);
+    }
+    released_extents.clear();
+}
+Pager::~Pager()
+{
+    stop_writeback();
+    free(header);
+    free(writeback_image);
+    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    {
+        for (PageVersion &version : page_versions[i])
+        {
+            free(version.image);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#ifndef DB_PAGER_H
+#define DB_PAGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "header_page.h"
+#include "node.h"
+#include "wal.h"
+
+enum LatchMode
+{
+    LATCH_SHARED,
+    LATCH_EXCLUSIVE
+};
+
+/* The writeback thread wakes up this often */
+#define WRITEBACK_INTERVAL_MS 100
+/* Pages dirty for longer than this are written back */
+#define WRITEBACK_MAX_DIRTY_AGE_MS 1000
+/* Above this share of the buffer pool being dirty, the oldest pages are written back */
+#define WRITEBACK_MAX_DIRTY_PERCENT 25
+/* Time between two checkpoints */
+#define CHECKPOINT_INTERVAL_MS 5000
+
+/* Commit timestamp of pages a writer has changed but not committed yet */
+const uint64_t PAGE_TS_PENDING = UINT64_MAX;
+
+/*
+A copy of a page as it was for snapshots taken at
+timestamps in [ts_from, ts_to).
+*/
+class PageVersion
+{
+public:
+    void *image;
+    uint64_t ts_from;
+    uint64_t ts_to;
+};
+
+/*
+Pager is safe to use from several threads. The page table is filled
+under page_table_mutex, but lookups of cached pages never take it.
+The bytes of a page are guarded by its frame latch: readers hold it
+shared, the writer that modifies the page holds it exclusive.
+
+Pages are also versioned for snapshot reads. Before a writer first
+changes a page it shadows it: the current image is copied into the
+page's version chain and the page is marked pending. Committing stamps
+every pending page with a new commit timestamp. A snapshot pins the
+last commit timestamp and reads, for every page, the image that was
+current at that time, so it never waits for writers. Old images are
+freed once no active snapshot can see them anymore.
+
+Every commit is logged to the write-ahead log before it becomes
+visible, see Wal. Commits that sync the log survive a crash.
+
+Committed pages are written to the db file by a background writeback
+thread, never by the threads that commit. It writes pages back once
+they have been dirty for a while or when too much of the buffer pool
+is dirty, and periodically takes a fuzzy checkpoint: it writes back
+every dirty page while writers keep going, then logs the LSN of the
+oldest commit that may still be missing from the db file, both in the
+log and in the header page, and frees the log before that commit.
+
+A compressed database compresses every page it writes to the db file
+into an extent, see HeaderPage; pages in memory are never compressed.
+A page that no longer fits its extent moves to a free one or to the
+end of the file. The extent it leaves may still hold the page the
+header on disk points to, so it is only reused once the header has
+been written again.
+*/
+class Pager
+{
+private:
+    int file_descriptor;
+    off_t file_length;
+    uint32_t page_size;
+    void *header; // page 0, see HeaderPage
+    PageCompression compression;
+    std::atomic<void *> pages[TABLE_MAX_PAGES];
+    std::shared_mutex latches[TABLE_MAX_PAGES];
+    std::mutex page_table_mutex;
+    uint32_t num_pages;
+
+    std::atomic<uint64_t> page_ts[TABLE_MAX_PAGES];
+    std::vector<PageVersion> page_versions[TABLE_MAX_PAGES];
+    std::mutex version_mutexes[TABLE_MAX_PAGES];
+    std::mutex commit_mutex;
+    uint64_t last_commit_ts;
+    std::multiset<uint64_t> active_snapshots;
+
+    Wal wal;
+
+    /* Pages with committed changes that are not in the db file yet */
+    std::mutex dirty_mutex;
+    bool dirty[TABLE_MAX_PAGES];
+    uint64_t dirty_lsn[TABLE_MAX_PAGES]; // first commit since the page was written
+    std::chrono::steady_clock::time_point dirty_since[TABLE_MAX_PAGES];
+
+    /* Extents of a compressed database, guarded by extent_mutex like the page map in the header */
+    std::mutex extent_mutex;
+    std::map<uint32_t, uint32_t> free_extents; // first sector to number of sectors
+    std::vector<std::pair<uint32_t, uint32_t>> released_extents; // free once the header is written
+    uint32_t end_sector;
+
+    std::thread writeback_thread;
+    void *writeback_image;
+    std::mutex writeback_image_mutex; // held across a write-back, and by a checkpoint until it is logged
+    std::mutex writeback_mutex;
+    std::condition_variable writeback_cv;
+    bool writeback_stopping;
+
+    void read_page(uint32_t page_num, void *page);
+    void replay_page(uint32_t page_num, uint64_t lsn, const char *image);
+    void load_extents();
+    uint32_t place_extent(uint32_t page_num, uint32_t size);
+    void free_extent(uint32_t sector, uint32_t num_sectors);
+    void reclaim_page_versions(uint32_t page_num);
+    void writeback_loop();
+    bool write_back_page(uint32_t page_num);
+    void write_back_old_pages();
+    void write_back_dirty_pages();
+    void write_header();
+
+public:
+    Pager(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression);
+
+    uint32_t get_page_size();
+    LeafLayout get_leaf_layout();
+    void *get_page(uint32_t page_num);
+    void latch_page(uint32_t page_num, LatchMode mode);
+    bool try_latch_page(uint32_t page_num, LatchMode mode);
+    void unlatch_page(uint32_t page_num, LatchMode mode);
+    void pager_flush(uint32_t page_num, void *image);
+    void print_tree(uint32_t page_num, uint32_t indentation_level);
+    uint32_t get_unused_page_num();
+
+    bool is_page_pending(uint32_t page_num);
+    void shadow_page(uint32_t page_num);
+    void commit_pages(std::vector<uint32_t> &page_nums, bool sync);
+    void rollback_pages(std::vector<uint32_t> &page_nums, uint32_t num_pages);
+    uint64_t begin_snapshot();
+    void end_snapshot(uint64_t snapshot_ts);
+    void read_page_version(uint32_t page_num, uint64_t snapshot_ts, void *destination);
+    void start_writeback();
+    void stop_writeback();
+    void checkpoint();
+    uint32_t get_index_root(Column column);
+    void set_index_root(Column column, uint32_t root_page_num);
+    ~Pager();
+
+    friend class Table;
+};
+
+#endif
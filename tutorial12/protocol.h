@@ -0,0 +1,119 @@
+#ifndef DB_PROTOCOL_H
+#define DB_PROTOCOL_H
+
+#include <string>
+
+#include "row.h"
+
+/*
+ * Binary protocol spoken over the server socket.
+ *
+ * Every request and response is a frame: a uint32_t length followed by
+ * that many bytes. A request frame starts with an opcode, a response
+ * frame with a status. Integers are in host byte order since both ends
+ * live on the same machine. Clients may pipeline any number of request
+ * frames; responses come back in the same order.
+ *
+ * Payloads:
+ *   OP_INSERT  row                      -> status
+ *   OP_GET     uint64_t id              -> status [row]
+ *   OP_SCAN    (empty)                  -> status uint32_t count row*
+ *
+ * A row is encoded as uint64_t id, uint8_t username length, username
+ * bytes, uint8_t email length, email bytes.
+ */
+const uint32_t FRAME_LENGTH_SIZE = sizeof(uint32_t);
+const uint32_t MAX_FRAME_SIZE = 4096;
+
+enum Opcode : uint8_t
+{
+    OP_INSERT = 1,
+    OP_GET = 2,
+    OP_SCAN = 3
+};
+enum Status : uint8_t
+{
+    STATUS_OK,
+    STATUS_NOT_FOUND,
+    STATUS_DUPLICATE_KEY,
+    STATUS_TABLE_FULL,
+    STATUS_BAD_REQUEST
+};
+
+inline void encode_uint32(std::string &out, uint32_t value)
+{
+    out.append((char *)&value, sizeof(value));
+}
+inline bool decode_uint32(const char *&cursor, const char *end, uint32_t &value)
+{
+    if (end - cursor < (long)sizeof(value))
+    {
+        return false;
+    }
+    memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return true;
+}
+inline void encode_uint64(std::string &out, uint64_t value)
+{
+    out.append((char *)&value, sizeof(value));
+}
+inline bool decode_uint64(const char *&cursor, const char *end, uint64_t &value)
+{
+    if (end - cursor < (long)sizeof(value))
+    {
+        return false;
+    }
+    memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return true;
+}
+inline void encode_row(std::string &out, const RowView &row)
+{
+    std::string_view username = row.username(), email = row.email();
+    encode_uint64(out, row.id());
+    out.push_back((uint8_t)username.size());
+    out.append(username);
+    out.push_back((uint8_t)email.size());
+    out.append(email);
+}
+inline bool decode_string(const char *&cursor, const char *end, char *destination, uint32_t max_length)
+{
+    if (cursor == end)
+    {
+        return false;
+    }
+    uint8_t length = *cursor++;
+    if (length > max_length || end - cursor < length)
+    {
+        return false;
+    }
+    memcpy(destination, cursor, length);
+    destination[length] = '\0';
+    cursor += length;
+    return true;
+}
+inline bool decode_row(const char *&cursor, const char *end, Row &row)
+{
+    return decode_uint64(cursor, end, row.id) &&
+           decode_string(cursor, end, row.username, COLUMN_USERNAME_SIZE) &&
+           decode_string(cursor, end, row.email, COLUMN_EMAIL_SIZE);
+}
+
+/*
+Frames are built in place: reserve the length, append the body,
+then patch the length once the body size is known.
+*/
+inline size_t begin_frame(std::string &out)
+{
+    size_t start = out.size();
+    encode_uint32(out, 0);
+    return start;
+}
+inline void end_frame(std::string &out, size_t start)
+{
+    uint32_t length = out.size() - start - FRAME_LENGTH_SIZE;
+    memcpy(&out[start], &length, sizeof(length));
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef DB_ROW_H
+#define DB_ROW_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#define COLUMN_USERNAME_SIZE 32
+#define COLUMN_EMAIL_SIZE 255
+class Row
+{
+public:
+    uint64_t id;
+    char username[COLUMN_USERNAME_SIZE + 1];
+    char email[COLUMN_EMAIL_SIZE + 1];
+    Row()
+    {
+        id = 0;
+        username[0] = '\0';
+        email[0] = '\0';
+    }
+    Row(uint64_t id, const char *username, const char *email)
+    {
+        this->id = id;
+        strncpy(this->username, username, COLUMN_USERNAME_SIZE + 1);
+        strncpy(this->email, email, COLUMN_EMAIL_SIZE + 1);
+    }
+};
+
+enum Column
+{
+    COLUMN_ID,
+    COLUMN_USERNAME,
+    COLUMN_EMAIL
+};
+#define NUM_COLUMNS 3
+
+/* A set of columns, one bit per column */
+inline uint32_t column_mask(Column column)
+{
+    return 1u << column;
+}
+const uint32_t ALL_COLUMNS = (1u << NUM_COLUMNS) - 1;
+
+#define size_of_attribute(Struct, Attribute) sizeof(((Struct *)0)->Attribute)
+
+const uint32_t ID_SIZE = size_of_attribute(Row, id);
+const uint32_t USERNAME_SIZE = size_of_attribute(Row, username);
+const uint32_t EMAIL_SIZE = size_of_attribute(Row, email);
+const uint32_t ID_OFFSET = 0;
+const uint32_t USERNAME_OFFSET = ID_OFFSET + ID_SIZE;
+const uint32_t EMAIL_OFFSET = USERNAME_OFFSET + USERNAME_SIZE;
+const uint32_t ROW_SIZE = ID_SIZE + USERNAME_SIZE + EMAIL_SIZE;
+
+inline uint32_t column_size(Column column)
+{
+    return column == COLUMN_ID ? ID_SIZE : column == COLUMN_USERNAME ? USERNAME_SIZE : EMAIL_SIZE;
+}
+
+inline const char *row_string_column(Row &row, Column column)
+{
+    return column == COLUMN_USERNAME ? row.username : row.email;
+}
+
+/*
+Rows are stored with their strings length-prefixed: one byte of
+length, then the bytes, with no terminator and no padding. A string
+column is as wide as its Row field, so every string still fits.
+*/
+inline void serialize_string(const char *source, uint32_t max_length, char *destination)
+{
+    size_t length = strnlen(source, max_length);
+    destination[0] = (char)length;
+    memcpy(destination + 1, source, length);
+}
+
+inline std::string_view stored_string(const char *source)
+{
+    return std::string_view(source + 1, (uint8_t)source[0]);
+}
+
+inline void deserialize_string(const char *source, char *destination)
+{
+    std::string_view value = stored_string(source);
+    memcpy(destination, value.data(), value.size());
+    destination[value.size()] = '\0';
+}
+
+inline void serialize_row(Row &source, void *destination)
+{
+    memcpy((char *)destination + ID_OFFSET, &(source.id), ID_SIZE);
+    serialize_string(source.username, COLUMN_USERNAME_SIZE, (char *)destination + USERNAME_OFFSET);
+    serialize_string(source.email, COLUMN_EMAIL_SIZE, (char *)destination + EMAIL_OFFSET);
+}
+
+/*
+A row read in place: the id and the strings as stored in a page, or
+in a Row. A view of a page is only valid while the page is pinned,
+for a cursor until it moves.
+*/
+class RowView
+{
+private:
+    const char *id_value;
+    std::string_view username_value;
+    std::string_view email_value;
+
+public:
+    RowView(const void *id, std::string_view username, std::string_view email)
+        : id_value((const char *)id), username_value(username), email_value(email) {}
+    RowView(const Row &row) : RowView(&row.id, row.username, row.email) {}
+
+    uint64_t id() const
+    {
+        uint64_t id;
+        memcpy(&id, id_value, ID_SIZE);
+        return id;
+    }
+    std::string_view username() const
+    {
+        return username_value;
+    }
+    std::string_view email() const
+    {
+        return email_value;
+    }
+    std::string_view string_column(Column column) const
+    {
+        return column == COLUMN_USERNAME ? username() : email();
+    }
+    void to_row(Row &row) const
+    {
+        row.id = id();
+        memcpy(row.username, username_value.data(), username_value.size());
+        row.username[username_value.size()] = '\0';
+        memcpy(row.email, email_value.data(), email_value.size());
+        row.email[email_value.size()] = '\0';
+    }
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include <iostream>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_READ_SIZE 65536
+
+static void set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        std::cerr << "Error setting non-blocking mode: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+Server::Server(Database *database, const char *socket_path)
+    : database(database), socket_path(socket_path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (this->socket_path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socket_path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        std::cerr << "Error creating socket: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    unlink(socket_path);
+    if (bind(listen_fd, (sockaddr *)&address, sizeof(address)) == -1 ||
+        listen(listen_fd, SOMAXCONN) == -1)
+    {
+        std::cerr << "Error listening on " << socket_path << ": " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    set_nonblocking(listen_fd);
+
+    /* SIGINT and SIGTERM are delivered through the event loop
+       so the database is closed cleanly on shutdown. */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    signal_fd = signalfd(-1, &mask, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0 || signal_fd < 0)
+    {
+        std::cerr << "Error creating event loop: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.fd = signal_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+}
+void Server::run()
+{
+    epoll_event events[SERVER_MAX_EVENTS];
+    while (true)
+    {
+        int num_events = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (num_events == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Error waiting for events: " << errno << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < num_events; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == signal_fd)
+            {
+                return;
+            }
+            else if (fd == listen_fd)
+            {
+                accept_connections();
+                continue;
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                handle_readable(fd);
+            }
+            if ((events[i].events & EPOLLOUT) && connections.count(fd))
+            {
+                handle_writable(fd);
+            }
+        }
+    }
+}
+void Server::accept_connections()
+{
+    while (true)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            // EAGAIN: no more pending connections
+            return;
+        }
+        set_nonblocking(fd);
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        connections[fd] = Connection();
+    }
+}
+void Server::handle_readable(int fd)
+{
+    Connection &connection = connections[fd];
+
+    char buffer[SERVER_READ_SIZE];
+    while (true)
+    {
+        ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+        if (bytes_read > 0)
+        {
+            connection.input.append(buffer, bytes_read);
+            continue;
+        }
+        if (bytes_read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            connection.peer_closed = true;
+        }
+        break;
+    }
+
+    /* Execute every complete frame, answering them all in one write */
+    size_t consumed = 0;
+    while (connection.input.size() - consumed >= FRAME_LENGTH_SIZE)
+    {
+        uint32_t length;
+        memcpy(&length, connection.input.data() + consumed, sizeof(length));
+        if (length == 0 || length > MAX_FRAME_SIZE)
+        {
+            close_connection(fd);
+            return;
+        }
+        if (connection.input.size() - consumed - FRAME_LENGTH_SIZE < length)
+        {
+            break;
+        }
+
+        const char *frame = connection.input.data() + consumed + FRAME_LENGTH_SIZE;
+        handle_request((uint8_t)frame[0], frame + 1, frame + length, connection.output);
+        consumed += FRAME_LENGTH_SIZE + length;
+    }
+    connection.input.erase(0, consumed);
+
+    if (!flush_output(fd, connection))
+    {
+        close_connection(fd);
+    }
+}
+void Server::handle_writable(int fd)
+{
+    if (!flush_output(fd, connections[fd]))
+    {
+        close_connection(fd);
+    }
+}
+bool Server::flush_output(int fd, Connection &connection)
+{
+    size_t written = 0;
+    while (written < connection.output.size())
+    {
+        ssize_t bytes_written = send(fd, connection.output.data() + written,
+                                     connection.output.size() - written, MSG_NOSIGNAL);
+        if (bytes_written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return false;
+            }
+            break;
+        }
+        written += bytes_written;
+    }
+    connection.output.erase(0, written);
+
+    bool want_write = !connection.output.empty();
+    if (connection.peer_closed)
+    {
+        /* The client is done sending; stay around only until
+           its remaining responses have been written. */
+        if (!want_write)
+        {
+            return false;
+        }
+        epoll_event event;
+        event.events = EPOLLOUT;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        connection.want_write = true;
+    }
+    else if (want_write != connection.want_write)
+    {
+        /* Only ask for EPOLLOUT while there is something left to write */
+        epoll_event event;
+        event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        connection.want_write = want_write;
+    }
+    return true;
+}
+void Server::close_connection(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+void Server::handle_request(uint8_t opcode, const char *payload, const char *end, std::string &output)
+{
+    size_t frame = begin_frame(output);
+    Row row;
+    uint64_t id;
+
+    switch (opcode)
+    {
+    case OP_INSERT:
+        if (!decode_row(payload, end, row))
+        {
+            output.push_back(STATUS_BAD_REQUEST);
+            break;
+        }
+        switch (database->insert(row))
+        {
+        case EXECUTE_SUCCESS:
+            output.push_back(STATUS_OK);
+            break;
+        case EXECUTE_DUPLICATE_KEY:
+            output.push_back(STATUS_DUPLICATE_KEY);
+            break;
+        case EXECUTE_TABLE_FULL:
+            output.push_back(STATUS_TABLE_FULL);
+            break;
+        default:
+            /* Results of statements the protocol has no request for */
+            output.push_back(STATUS_BAD_REQUEST);
+            break;
+        }
+        break;
+    case OP_GET:
+        if (!decode_uint64(payload, end, id))
+        {
+            output.push_back(STATUS_BAD_REQUEST);
+        }
+        else if (database->get(id, row))
+        {
+            output.push_back(STATUS_OK);
+            encode_row(output, row);
+        }
+        else
+        {
+            output.push_back(STATUS_NOT_FOUND);
+        }
+        break;
+    case OP_SCAN:
+    {
+        output.push_back(STATUS_OK);
+        size_t count_offset = output.size();
+        uint32_t count = 0;
+        encode_uint32(output, count);
+        database->scan_views(0, UINT32_MAX, [&](const RowView &row)
+                             {
+                                 encode_row(output, row);
+                                 count++;
+                             });
+        memcpy(&output[count_offset], &count, sizeof(count));
+        break;
+    }
+    default:
+        output.push_back(STATUS_BAD_REQUEST);
+        break;
+    }
+
+    end_frame(output, frame);
+}
+Server::~Server()
+{
+    for (auto &entry : connections)
+    {
+        close(entry.first);
+    }
+    close(epoll_fd);
+    close(signal_fd);
+    close(listen_fd);
+    unlink(socket_path.c_str());
+}
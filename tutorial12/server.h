@@ -0,0 +1,48 @@
+#ifndef DB_SERVER_H
+#define DB_SERVER_H
+
+#include <string>
+#include <unordered_map>
+
+#include "database.h"
+#include "protocol.h"
+
+class Connection
+{
+public:
+    std::string input;  // bytes read but not yet parsed into requests
+    std::string output; // responses not yet written to the socket
+    bool want_write = false;
+    bool peer_closed = false;
+};
+
+/*
+Server shares one Database between every client connected to a Unix
+domain socket. A single epoll loop reads whatever requests a client
+has pipelined, executes all complete frames and answers them with one
+write.
+*/
+class Server
+{
+private:
+    Database *database;
+    std::string socket_path;
+    int listen_fd;
+    int epoll_fd;
+    int signal_fd;
+    std::unordered_map<int, Connection> connections;
+
+    void accept_connections();
+    void handle_readable(int fd);
+    void handle_writable(int fd);
+    bool flush_output(int fd, Connection &connection);
+    void close_connection(int fd);
+    void handle_request(uint8_t opcode, const char *payload, const char *end, std::string &output);
+
+public:
+    Server(Database *database, const char *socket_path);
+    void run();
+    ~Server();
+};
+
+#endif
@@ -0,0 +1,834 @@
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "table.h"
+
+Table::Table(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression)
+    : pager(filename, page_size, layout, compression)
+{
+    root_page_num = *HeaderPage(pager.header).header_root_page();
+    synchronous = true;
+    writers_excluded = false;
+    if (pager.num_pages <= root_page_num)
+    {
+        // New database. Initialize the root page as leaf node.
+        pager.get_unused_page_num();
+        LeafNode root_node = pager.get_page(root_page_num);
+        root_node.initialize_leaf_node(pager.get_page_size(), pager.get_leaf_layout());
+        root_node.set_node_root(true);
+
+        /* Logged like any other change, the writeback thread writes it out */
+        std::vector<uint32_t> root_page = {root_page_num};
+        pager.commit_pages(root_page, true);
+    }
+    pager.start_writeback();
+}
+Cursor::Cursor(Table *table, Transaction *transaction, uint32_t offset)
+{
+    /*
+    Start a scan at the row with the given position, using the row
+    counts of the internal nodes to pick the child that holds it.
+    */
+    this->table = table;
+    this->latch_mode = LATCH_SHARED;
+    this->transaction = transaction;
+
+    /*
+    Scans in a transaction must see its own pending changes. It is
+    the only writer, so the live pages can be read without latches.
+    Other scans read a snapshot of the last commit.
+    */
+    this->is_snapshot = transaction == nullptr;
+    this->snapshot_page = nullptr;
+    void *page;
+    page_num = table->root_page_num;
+    if (is_snapshot)
+    {
+        this->snapshot_ts = table->pager.begin_snapshot();
+        this->snapshot_page = malloc(table->pager.get_page_size());
+        table->pager.read_page_version(page_num, snapshot_ts, snapshot_page);
+        page = snapshot_page;
+    }
+    else
+    {
+        page = table->pager.get_page(page_num);
+    }
+
+    while (Node(page).get_node_type() == NODE_INTERNAL)
+    {
+        InternalNode internal_node = page;
+        uint32_t num_keys = *internal_node.internal_node_num_keys();
+        uint32_t child_index = 0;
+        while (child_index < num_keys && offset >= *internal_node.internal_node_row_count(child_index))
+        {
+            offset -= *internal_node.internal_node_row_count(child_index);
+            child_index++;
+        }
+        page_num = *internal_node.internal_node_child(child_index);
+        if (is_snapshot)
+        {
+            table->pager.read_page_version(page_num, snapshot_ts, snapshot_page);
+        }
+        else
+        {
+            page = table->pager.get_page(page_num);
+        }
+    }
+    this->cell_num = offset;
+
+    LeafNode leaf_node = page;
+    this->end_of_table = (offset >= *leaf_node.leaf_node_num_cells());
+}
+Cursor::Cursor(Table *table, uint32_t page_num, uint64_t key)
+{
+    this->table = table;
+    this->page_num = page_num;
+    this->end_of_table = false;
+    this->latch_mode = LATCH_SHARED;
+    this->transaction = nullptr;
+    this->is_snapshot = false;
+    this->snapshot_page = nullptr;
+
+    LeafNode root_node = table->pager.get_page(page_num);
+    uint32_t num_cells = *root_node.leaf_node_num_cells();
+
+    this->cell_num = root_node.leaf_node_find_cell(key, num_cells);
+}
+void *Cursor::cursor_page()
+{
+    if (is_snapshot)
+    {
+        return snapshot_page;
+    }
+    return table->pager.get_page(page_num);
+}
+void Cursor::cursor_row(Row &row, uint32_t columns)
+{
+    LeafNode(cursor_page()).leaf_node_read_row(cell_num, row, columns);
+}
+RowView Cursor::cursor_row_view()
+{
+    /* The row as stored in the leaf, valid until the cursor moves */
+    return LeafNode(cursor_page()).leaf_node_row(cell_num);
+}
+void Cursor::mark_page_written(uint32_t page_num)
+{
+    /* Keep the committed image around for snapshots before changing the page */
+    if (std::find(written_pages.begin(), written_pages.end(), page_num) == written_pages.end())
+    {
+        table->pager.shadow_page(page_num);
+        written_pages.push_back(page_num);
+    }
+}
+uint32_t Cursor::allocate_page()
+{
+    uint32_t page_num = table->pager.get_unused_page_num();
+    written_pages.push_back(page_num);
+    return page_num;
+}
+void Cursor::commit()
+{
+    /* Called before the latches are released, see ~Cursor */
+    if (transaction != nullptr)
+    {
+        /* The pages stay pending until the transaction commits */
+        for (uint32_t written_page_num : written_pages)
+        {
+            std::vector<uint32_t> &pages = transaction->written_pages;
+            if (std::find(pages.begin(), pages.end(), written_page_num) == pages.end())
+            {
+                pages.push_back(written_page_num);
+            }
+        }
+    }
+    else
+    {
+        table->pager.commit_pages(written_pages, table->synchronous);
+    }
+    written_pages.clear();
+}
+void Cursor::cursor_advance()
+{
+    LeafNode leaf_node = cursor_page();
+    cell_num += 1;
+    if (cell_num >= *leaf_node.leaf_node_num_cells())
+    {
+        /* Advance to next leaf node */
+        uint32_t next_page_num = *leaf_node.leaf_node_next_leaf();
+        if (next_page_num == 0)
+        {
+            /* This was rightmost leaf */
+            end_of_table = true;
+        }
+        else if (is_snapshot)
+        {
+            page_num = next_page_num;
+            cell_num = 0;
+            table->pager.read_page_version(page_num, snapshot_ts, snapshot_page);
+        }
+        else
+        {
+            /* Couple the latch over to the next leaf */
+            if (!latched_pages.empty())
+            {
+                table->pager.latch_page(next_page_num, latch_mode);
+                table->pager.unlatch_page(page_num, latch_mode);
+                latched_pages.back() = next_page_num;
+            }
+            page_num = next_page_num;
+            cell_num = 0;
+        }
+    }
+}
+void Cursor::cursor_fill_batch(Batch &batch, uint32_t columns, const StringFilter *filter)
+{
+    /*
+    Fill batch with the given columns of the rows from the cursor on,
+    a run of cells per leaf, and leave the cursor after the last one.
+    With a filter the leaf tests it first and only the rows that match
+    are copied out.
+    */
+    batch.columns = columns;
+    batch.num_rows = 0;
+    uint32_t cells[BATCH_SIZE];
+    while (!end_of_table && batch.num_rows < BATCH_SIZE)
+    {
+        LeafNode leaf_node = cursor_page();
+        uint32_t count = std::min(*leaf_node.leaf_node_num_cells() - cell_num, BATCH_SIZE - batch.num_rows);
+        uint32_t num_matches = count;
+        if (filter != nullptr)
+        {
+            std::string_view value(filter->value);
+            num_matches = leaf_node.leaf_node_filter(cell_num, count, filter->column, value, filter->prefix, cells);
+        }
+        for (uint32_t column = 0; column < NUM_COLUMNS; column++)
+        {
+            if (columns & column_mask((Column)column))
+            {
+                char *values = (char *)batch.column_values((Column)column);
+                values += batch.num_rows * column_size((Column)column);
+                if (filter != nullptr)
+                {
+                    leaf_node.leaf_node_read_cells(cells, num_matches, (Column)column, values);
+                }
+                else
+                {
+                    leaf_node.leaf_node_read_column(cell_num, count, (Column)column, values);
+                }
+            }
+        }
+        batch.num_rows += num_matches;
+        cell_num += count - 1;
+        cursor_advance();
+    }
+    batch.select_all();
+}
+void Cursor::internal_node_insert(uint32_t parent_page_num, uint32_t child_page_num)
+{
+    /*
+    Add a new child/key pair to parent that corresponds to child
+    */
+
+    InternalNode parent = table->pager.get_page(parent_page_num);
+    Node child = table->pager.get_page(child_page_num);
+    uint64_t child_max_key = child.get_node_max_key();
+    uint32_t index = parent.internal_node_find_child(child_max_key);
+
+    uint32_t original_num_keys = *parent.internal_node_num_keys();
+    mark_page_written(parent_page_num);
+    *parent.internal_node_num_keys() = original_num_keys + 1;
+
+    if (original_num_keys >= INTERNAL_NODE_MAX_CELLS)
+    {
+        std::cout << "Need to implement splitting internal node" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    /*
+    The new child only goes after the right child if it was split off
+    from it by this cursor. Any other right child may be latched by a
+    writer that waits for this node to count its row, so it is not read.
+    */
+    uint32_t right_child_page_num = *parent.internal_node_right_child();
+    if (std::find(latched_pages.begin(), latched_pages.end(), right_child_page_num) != latched_pages.end())
+    {
+        /* Replace right child */
+        *parent.internal_node_child(original_num_keys) = right_child_page_num;
+        *parent.internal_node_key(original_num_keys) = Node(table->pager.get_page(right_child_page_num)).get_node_max_key();
+        *parent.internal_node_row_count(original_num_keys) = *parent.internal_node_right_child_row_count();
+        *parent.internal_node_right_child() = child_page_num;
+    }
+    else
+    {
+        /* Make room for the new cell */
+        for (uint32_t i = original_num_keys; i > index; i--)
+        {
+            void *destination = parent.internal_node_cell(i);
+            void *source = parent.internal_node_cell(i - 1);
+            memcpy(destination, source, INTERNAL_NODE_CELL_SIZE);
+        }
+        *parent.internal_node_child(index) = child_page_num;
+        *parent.internal_node_key(index) = child_max_key;
+    }
+}
+void Cursor::leaf_node_insert(uint64_t key, Row &value)
+{
+    LeafNode leaf_node = table->pager.get_page(page_num);
+    uint32_t num_cells = *leaf_node.leaf_node_num_cells();
+
+    if (num_cells >= leaf_node.leaf_node_max_cells())
+    {
+        // Node full
+        leaf_node_split_and_insert(key, value);
+        update_row_counts(key);
+        return;
+    }
+
+    mark_page_written(page_num);
+    if (cell_num < num_cells)
+    {
+        // make room for new cell
+        for (uint32_t i = num_cells; i > cell_num; i--)
+        {
+            leaf_node.leaf_node_copy_cell(i, leaf_node, i - 1);
+        }
+    }
+
+    // insert new cell
+    *leaf_node.leaf_node_num_cells() += 1;
+    leaf_node.leaf_node_write_cell(cell_num, key, value);
+    update_row_counts(key);
+}
+void Cursor::update_row_counts(uint64_t key)
+{
+    /*
+    The cursor latched the nodes from the topmost one the insert may
+    change down to its leaf. Going up from the leaf, refresh the row
+    counts each of those internal nodes keeps for the children this
+    insert wrote; the counts of the other children did not change.
+    */
+    for (auto it = latched_pages.rbegin(); it != latched_pages.rend(); ++it)
+    {
+        Node node = table->pager.get_page(*it);
+        if (node.get_node_type() != NODE_INTERNAL)
+        {
+            continue;
+        }
+        mark_page_written(*it);
+        InternalNode internal_node = node.get_node();
+        uint32_t num_keys = *internal_node.internal_node_num_keys();
+        for (uint32_t i = 0; i <= num_keys; i++)
+        {
+            uint32_t child_page_num = *internal_node.internal_node_child(i);
+            if (std::find(written_pages.begin(), written_pages.end(), child_page_num) != written_pages.end())
+            {
+                *internal_node.internal_node_row_count(i) = Node(table->pager.get_page(child_page_num)).get_node_row_count();
+            }
+        }
+    }
+
+    /*
+    The nodes above only gain the new row in the count of the child
+    on its path. They are latched from the root down and kept until
+    the insert commits, so each commit logs counts that agree with its
+    leaves. None of them is waited for while holding another: its
+    holder may be waiting for a node above it. If one is busy, let go
+    of the others, wait for it and start over from the root.
+    */
+    uint32_t top_page_num = latched_pages.front();
+    std::vector<uint32_t> ancestors;
+    uint32_t ancestor_page_num = table->root_page_num;
+    while (ancestor_page_num != top_page_num)
+    {
+        if (!table->pager.try_latch_page(ancestor_page_num, LATCH_EXCLUSIVE))
+        {
+            for (uint32_t latched_page_num : ancestors)
+            {
+                table->pager.unlatch_page(latched_page_num, LATCH_EXCLUSIVE);
+            }
+            ancestors.clear();
+            table->pager.latch_page(ancestor_page_num, LATCH_EXCLUSIVE);
+            table->pager.unlatch_page(ancestor_page_num, LATCH_EXCLUSIVE);
+            ancestor_page_num = table->root_page_num;
+            continue;
+        }
+        ancestors.push_back(ancestor_page_num);
+        InternalNode internal_node = table->pager.get_page(ancestor_page_num);
+        ancestor_page_num = *internal_node.internal_node_child(internal_node.internal_node_find_child(key));
+    }
+    for (uint32_t latched_page_num : ancestors)
+    {
+        InternalNode internal_node = table->pager.get_page(latched_page_num);
+        mark_page_written(latched_page_num);
+        *internal_node.internal_node_row_count(internal_node.internal_node_find_child(key)) += 1;
+        latched_pages.push_back(latched_page_num);
+    }
+}
+void Cursor::leaf_node_split_and_insert(uint64_t key, Row &value)
+{
+    /*
+    Create a new node and move half the cells over.
+    Insert the new value in one of the two nodes.
+    Update parent or create a new parent.
+    */
+
+    LeafNode old_node = table->pager.get_page(page_num);
+    uint64_t old_max = old_node.get_node_max_key();
+    mark_page_written(page_num);
+
+    uint32_t new_page_num = allocate_page();
+    LeafNode new_node = table->pager.get_page(new_page_num);
+    new_node.initialize_leaf_node(*old_node.node_page_size(), old_node.get_leaf_layout());
+
+    *new_node.node_parent() = *old_node.node_parent();
+
+    *new_node.leaf_node_next_leaf() = *old_node.leaf_node_next_leaf();
+    *old_node.leaf_node_next_leaf() = new_page_num;
+
+    /*
+    All existing keys plus new key should be divided
+    evenly between old (left) and new (right) nodes.
+    Starting from the right, move each key to correct position.
+    */
+    uint32_t left_split_count = leaf_node_left_split_count(*old_node.node_page_size());
+    uint32_t right_split_count = leaf_node_right_split_count(*old_node.node_page_size());
+    /* i runs from leaf_node_max_cells() down to 0 inclusive */
+    for (uint32_t i = old_node.leaf_node_max_cells() + 1; i-- > 0;)
+    {
+        LeafNode destination_node;
+        if (i >= left_split_count)
+        {
+            destination_node = new_node;
+        }
+        else
+        {
+            destination_node = old_node;
+        }
+        uint32_t index_within_node = i % left_split_count;
+
+        if (i == cell_num)
+        {
+            destination_node.leaf_node_write_cell(index_within_node, key, value);
+        }
+        else if (i > cell_num)
+        {
+            destination_node.leaf_node_copy_cell(index_within_node, old_node, i - 1);
+        }
+        else
+        {
+            destination_node.leaf_node_copy_cell(index_within_node, old_node, i);
+        }
+    }
+    /* Update cell count on both leaf nodes */
+    *old_node.leaf_node_num_cells() = left_split_count;
+    *new_node.leaf_node_num_cells() = right_split_count;
+
+    if (old_node.is_node_root())
+    {
+        return table->create_new_root(new_page_num, this);
+    }
+    else
+    {
+        uint32_t parent_page_num = *old_node.node_parent();
+        uint64_t new_max = old_node.get_node_max_key();
+        InternalNode parent = table->pager.get_page(parent_page_num);
+        mark_page_written(parent_page_num);
+        parent.update_internal_node_key(old_max, new_max);
+        internal_node_insert(parent_page_num, new_page_num);
+        return;
+    }
+}
+Cursor::~Cursor()
+{
+    if (is_snapshot)
+    {
+        table->pager.end_snapshot(snapshot_ts);
+        free(snapshot_page);
+    }
+    while (!latched_pages.empty())
+    {
+        table->pager.unlatch_page(latched_pages.back(), latch_mode);
+        latched_pages.pop_back();
+    }
+}
+bool Table::is_node_safe(uint32_t page_num)
+{
+    /*
+    A node is safe if inserting into it cannot split it,
+    so the insert will not change any of its ancestors
+    but their row counts.
+    */
+    Node node = pager.get_page(page_num);
+    if (node.get_node_type() == NODE_LEAF)
+    {
+        return *LeafNode(node.get_node()).leaf_node_num_cells() < leaf_node_max_cells(pager.get_page_size());
+    }
+    else
+    {
+        return *InternalNode(node.get_node()).internal_node_num_keys() < INTERNAL_NODE_MAX_CELLS;
+    }
+}
+bool Table::latch_child(uint32_t child_page_num, LatchMode mode, std::vector<uint32_t> &latched_pages)
+{
+    /*
+    Never wait for a child while holding its ancestors: the writer
+    holding the child may be waiting for one of them to count its
+    row. Let go of the path instead, wait for the child and return
+    false, so the caller starts over from the root.
+    */
+    if (!pager.try_latch_page(child_page_num, mode))
+    {
+        for (uint32_t latched_page_num : latched_pages)
+        {
+            pager.unlatch_page(latched_page_num, mode);
+        }
+        latched_pages.clear();
+        pager.latch_page(child_page_num, mode);
+        pager.unlatch_page(child_page_num, mode);
+        return false;
+    }
+    if (mode == LATCH_SHARED || is_node_safe(child_page_num))
+    {
+        /* Readers only need the parent until the child is latched,
+           writers until they reach a safe child */
+        for (uint32_t latched_page_num : latched_pages)
+        {
+            pager.unlatch_page(latched_page_num, mode);
+        }
+        latched_pages.clear();
+    }
+    latched_pages.push_back(child_page_num);
+    return true;
+}
+uint32_t Table::row_count(Transaction *transaction)
+{
+    /* The root knows how many rows are in each of its children */
+    if (transaction != nullptr)
+    {
+        return Node(pager.get_page(root_page_num)).get_node_row_count();
+    }
+
+    uint64_t snapshot_ts = pager.begin_snapshot();
+    void *page = malloc(pager.get_page_size());
+    pager.read_page_version(root_page_num, snapshot_ts, page);
+    uint32_t row_count = Node(page).get_node_row_count();
+    free(page);
+    pager.end_snapshot(snapshot_ts);
+
+    return row_count;
+}
+uint32_t Table::key_range(Transaction *transaction, uint64_t &min_key, uint64_t &max_key)
+{
+    /*
+    Read the row count from the root and the smallest and largest keys
+    from the leftmost and rightmost leaves, all as of one snapshot.
+    The keys are only set if there are rows.
+    */
+    uint64_t snapshot_ts = 0;
+    void *page = nullptr;
+    auto read_page = [&](uint32_t page_num)
+    {
+        if (transaction != nullptr)
+        {
+            return pager.get_page(page_num);
+        }
+        pager.read_page_version(page_num, snapshot_ts, page);
+        return page;
+    };
+    if (transaction == nullptr)
+    {
+        snapshot_ts = pager.begin_snapshot();
+        page = malloc(pager.get_page_size());
+    }
+
+    Node root = read_page(root_page_num);
+    uint32_t row_count = root.get_node_row_count();
+    uint32_t first_page_nums[2] = {root_page_num, root_page_num};
+    if (root.get_node_type() == NODE_INTERNAL)
+    {
+        /* Take both children while the root is read, so it is only read once */
+        InternalNode internal_node = root.get_node();
+        first_page_nums[0] = *internal_node.internal_node_child(0);
+        first_page_nums[1] = *internal_node.internal_node_right_child();
+    }
+    for (uint32_t side = 0; side < 2 && row_count > 0; side++)
+    {
+        Node node = read_page(first_page_nums[side]);
+        while (node.get_node_type() == NODE_INTERNAL)
+        {
+            InternalNode internal_node = node.get_node();
+            node = read_page(side == 0 ? *internal_node.internal_node_child(0)
+                                       : *internal_node.internal_node_right_child());
+        }
+        LeafNode leaf_node = node.get_node();
+        if (side == 0)
+        {
+            min_key = *leaf_node.leaf_node_key(0);
+        }
+        else
+        {
+            max_key = *leaf_node.leaf_node_key(*leaf_node.leaf_node_num_cells() - 1);
+        }
+    }
+
+    if (transaction == nullptr)
+    {
+        free(page);
+        pager.end_snapshot(snapshot_ts);
+    }
+    return row_count;
+}
+Cursor *Table::internal_node_find(uint32_t page_num, uint64_t key, LatchMode mode, std::vector<uint32_t> &latched_pages)
+{
+    InternalNode node = pager.get_page(page_num);
+
+    uint32_t child_index = node.internal_node_find_child(key);
+    uint32_t child_num = *node.internal_node_child(child_index);
+    if (!latch_child(child_num, mode, latched_pages))
+    {
+        return nullptr;
+    }
+
+    Node child = pager.get_page(child_num);
+    switch (child.get_node_type())
+    {
+    case NODE_INTERNAL:
+        return internal_node_find(child_num, key, mode, latched_pages);
+    case NODE_LEAF:
+    default:
+    {
+        Cursor *cursor = new Cursor(this, child_num, key);
+        cursor->latch_mode = mode;
+        cursor->latched_pages.swap(latched_pages);
+        return cursor;
+    }
+    }
+}
+bool Table::optimistic_find(uint64_t key, uint32_t &leaf_page_num, uint32_t &leaf_version)
+{
+    /*
+    Walk from the root to the leaf without latching or writing any
+    page. Each node's version is validated after reading from it, and
+    before following a child pointer read from it. Returns false if a
+    writer got in the way and the caller has to restart.
+    */
+    uint32_t page_num = root_page_num;
+    Node node = pager.get_page(page_num);
+    uint32_t version = node.read_node_version();
+
+    while (true)
+    {
+        if (version & 1)
+        {
+            return false;
+        }
+        if (node.get_node_type() == NODE_LEAF)
+        {
+            if (!node.validate_node_version(version))
+            {
+                return false;
+            }
+            leaf_page_num = page_num;
+            leaf_version = version;
+            return true;
+        }
+
+        InternalNode internal_node = node.get_node();
+        uint32_t num_keys = *internal_node.internal_node_num_keys();
+        if (num_keys > INTERNAL_NODE_MAX_CELLS)
+        {
+            return false;
+        }
+        uint32_t child_index = internal_node.internal_node_find_child(key, num_keys);
+        uint32_t child_num = child_index == num_keys
+                                 ? *internal_node.internal_node_right_child()
+                                 : *internal_node.internal_node_cell(child_index);
+        if (!node.validate_node_version(version) || child_num >= TABLE_MAX_PAGES)
+        {
+            return false;
+        }
+
+        Node child = pager.get_page(child_num);
+        uint32_t child_version = child.read_node_version();
+        if (!node.validate_node_version(version))
+        {
+            return false;
+        }
+        page_num = child_num;
+        node = child;
+        version = child_version;
+    }
+}
+Cursor *Table::table_find(uint64_t key, LatchMode mode, Transaction *transaction)
+{
+    bool may_be_excluded = mode == LATCH_EXCLUSIVE && transaction == nullptr;
+    while (true)
+    {
+        if (may_be_excluded && writers_excluded)
+        {
+            /* Wait for the exclusive writer, see exclude_writers */
+            std::lock_guard<std::mutex> wait_guard(writer_lock);
+        }
+        Cursor *cursor = table_find(key, mode);
+        cursor->transaction = transaction;
+
+        /* Look again now that the leaf is held, before changing anything */
+        if (!may_be_excluded || !writers_excluded)
+        {
+            return cursor;
+        }
+        delete cursor;
+    }
+}
+Cursor *Table::table_find(uint64_t key, LatchMode mode)
+{
+    if (mode == LATCH_EXCLUSIVE)
+    {
+        /*
+        Most inserts only change their leaf. Find it optimistically
+        and latch just the leaf; if it changed in the meantime or may
+        split, fall back to latch coupling from the root.
+        */
+        uint32_t leaf_page_num, leaf_version;
+        if (optimistic_find(key, leaf_page_num, leaf_version))
+        {
+            pager.latch_page(leaf_page_num, LATCH_EXCLUSIVE);
+            Node leaf = pager.get_page(leaf_page_num);
+            if (leaf.validate_node_version(leaf_version + 1) && is_node_safe(leaf_page_num))
+            {
+                Cursor *cursor = new Cursor(this, leaf_page_num, key);
+                cursor->latch_mode = LATCH_EXCLUSIVE;
+                cursor->latched_pages.push_back(leaf_page_num);
+                return cursor;
+            }
+            pager.unlatch_page(leaf_page_num, LATCH_EXCLUSIVE);
+        }
+    }
+
+    /* Start over from the root whenever a latch could not be taken */
+    while (true)
+    {
+        std::vector<uint32_t> latched_pages;
+        if (!latch_child(root_page_num, mode, latched_pages))
+        {
+            continue;
+        }
+
+        Node root_node = pager.get_page(root_page_num);
+        if (root_node.get_node_type() == NODE_LEAF)
+        {
+            Cursor *cursor = new Cursor(this, root_page_num, key);
+            cursor->latch_mode = mode;
+            cursor->latched_pages.swap(latched_pages);
+            return cursor;
+        }
+
+        Cursor *cursor = internal_node_find(root_page_num, key, mode, latched_pages);
+        if (cursor != nullptr)
+        {
+            return cursor;
+        }
+    }
+}
+void Table::create_new_root(uint32_t right_child_page_num, Cursor *cursor)
+{
+    /*
+    Handle splitting the root.
+    Old root copied to new page, becomes left child.
+    Address of right child passed in.
+    Re-initialize root page to contain the new root node.
+    New root node points to two children.
+    */
+
+    InternalNode root = pager.get_page(root_page_num);
+    Node right_child = pager.get_page(right_child_page_num);
+    uint32_t left_child_page_num = cursor->allocate_page();
+    cursor->mark_page_written(root_page_num);
+    Node left_child = pager.get_page(left_child_page_num);
+
+    /* Left child has data copied from old root */
+    memcpy(left_child.get_node(), root.get_node(), pager.get_page_size());
+    left_child.set_node_root(false);
+    /* The copy carries the root's locked version; the new page is not latched */
+    *left_child.node_version() = 0;
+
+    /* Root node is a new internal node with one key and two children */
+    root.initialize_internal_node(pager.get_page_size());
+    root.set_node_root(true);
+    *root.internal_node_num_keys() = 1;
+    *root.internal_node_child(0) = left_child_page_num;
+    uint64_t left_child_max_key = left_child.get_node_max_key();
+    *root.internal_node_key(0) = left_child_max_key;
+    *root.internal_node_right_child() = right_child_page_num;
+
+    *left_child.node_parent() = root_page_num;
+    *right_child.node_parent() = root_page_num;
+}
+void Table::exclude_writers()
+{
+    /*
+    Make the caller the only writer until admit_writers. Writers that
+    do not hold their leaf yet will find writers_excluded set and wait.
+    The others keep a latch until they have committed, so waiting once
+    for every page lets them finish.
+    */
+    writer_lock.lock();
+    writers_excluded = true;
+    for (uint32_t page_num = 0; page_num < TABLE_MAX_PAGES; page_num++)
+    {
+        pager.latch_page(page_num, LATCH_SHARED);
+        pager.unlatch_page(page_num, LATCH_SHARED);
+    }
+}
+void Table::admit_writers()
+{
+    writers_excluded = false;
+    writer_lock.unlock();
+}
+Transaction *Table::begin_transaction()
+{
+    exclude_writers();
+    Transaction *transaction = new Transaction();
+    transaction->num_pages = pager.num_pages;
+    return transaction;
+}
+void Table::commit_transaction(Transaction *transaction)
+{
+    /* A single log sync makes the whole transaction durable */
+    if (!transaction->written_pages.empty())
+    {
+        pager.commit_pages(transaction->written_pages, true);
+    }
+    delete transaction;
+    admit_writers();
+}
+void Table::rollback_transaction(Transaction *transaction)
+{
+    pager.rollback_pages(transaction->written_pages, transaction->num_pages);
+    delete transaction;
+    admit_writers();
+}
+Table::~Table()
+{
+    /* Write back what is still dirty, after which the log can go */
+    pager.stop_writeback();
+    pager.checkpoint();
+
+    int result = close(pager.file_descriptor);
+    if (result == -1)
+    {
+        std::cout << "Error closing db file." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    {
+        void *page = pager.pages[i];
+        if (page)
+        {
+            free(page);
+            pager.pages[i] = nullptr;
+        }
+    }
+}
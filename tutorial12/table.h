@@ -0,0 +1,131 @@
+#ifndef DB_TABLE_H
+#define DB_TABLE_H
+
+#include <vector>
+
+#include "batch.h"
+#include "pager.h"
+
+enum ExecuteResult
+{
+    EXECUTE_SUCCESS,
+    EXECUTE_TABLE_FULL,
+    EXECUTE_DUPLICATE_KEY,
+    EXECUTE_TRANSACTION_OPEN,
+    EXECUTE_NO_TRANSACTION,
+    EXECUTE_INDEX_EXISTS
+};
+
+class Table;
+
+/*
+An explicit transaction. Its changes stay pending in the pages it
+wrote, invisible to everybody else, until it commits or rolls back.
+*/
+class Transaction
+{
+public:
+    std::vector<uint32_t> written_pages;
+    uint32_t num_pages; // pages in the table when the transaction began
+};
+
+class Cursor
+{
+private:
+    Table *table;
+    uint32_t page_num;
+    uint32_t cell_num;
+    bool end_of_table;
+    LatchMode latch_mode;
+    Transaction *transaction;
+    std::vector<uint32_t> latched_pages; // released when the cursor is deleted
+    std::vector<uint32_t> written_pages; // stamped when the write commits
+
+    /* Scans read a private copy of each leaf as of their snapshot */
+    bool is_snapshot;
+    uint64_t snapshot_ts;
+    void *snapshot_page;
+
+    void *cursor_page();
+    void mark_page_written(uint32_t page_num);
+    uint32_t allocate_page();
+    void update_row_counts(uint64_t key);
+
+public:
+    Cursor(Table *table, Transaction *transaction = nullptr, uint32_t offset = 0);
+    Cursor(Table *table, uint32_t page_num, uint64_t key);
+    void cursor_row(Row &row, uint32_t columns = ALL_COLUMNS);
+    RowView cursor_row_view();
+    void cursor_advance();
+    void cursor_fill_batch(Batch &batch, uint32_t columns, const StringFilter *filter = nullptr);
+    void commit();
+    void leaf_node_insert(uint64_t key, Row &value);
+    void leaf_node_split_and_insert(uint64_t key, Row &value);
+    void internal_node_insert(uint32_t parent_page_num, uint32_t child_page_num);
+    ~Cursor();
+
+    friend class Table;
+    friend class Database;
+    friend class Index;
+};
+
+/*
+Table allows any number of concurrent readers and writers.
+
+Point lookups use optimistic lock coupling: they read nodes without
+latching them and validate node versions instead, so they never
+write to shared pages such as the root.
+
+Scans read a snapshot of the tree as of the last commit and never
+wait for writers (see Pager). Writers first look for their leaf
+optimistically and latch only that leaf if it will not split.
+Otherwise they couple exclusive latches from the root and release all
+ancestors once they reach a node that is safe, i.e. one that will not
+split, so writers in disjoint key ranges only meet at nodes that are
+about to change. Nobody waits for a latch while holding a parent;
+they let go of the path and start over instead.
+
+Row counts are the exception: every insert adds its row to the count
+of each node above its leaf. A writer latches the nodes above the
+ones it kept only once its leaf is done, from the root down, and
+holds them until it commits. Writers on different leaves thus search
+and change their leaves in parallel and only take turns to count
+their rows, add their index keys and commit.
+
+An explicit transaction or an index build excludes all other writers
+from start to end, see exclude_writers. Readers are never excluded.
+*/
+class Table
+{
+private:
+    uint32_t root_page_num;
+    Pager pager;
+    std::mutex writer_lock; // held by the exclusive writer
+    std::atomic<bool> writers_excluded;
+    bool synchronous; // sync the log on every single-insert commit
+
+    bool is_node_safe(uint32_t page_num);
+    bool latch_child(uint32_t child_page_num, LatchMode mode, std::vector<uint32_t> &latched_pages);
+    void exclude_writers();
+    void admit_writers();
+
+public:
+    Table(const char *filename, uint32_t page_size, LeafLayout layout, PageCompression compression);
+    bool optimistic_find(uint64_t key, uint32_t &leaf_page_num, uint32_t &leaf_version);
+    Cursor *table_find(uint64_t key, LatchMode mode);
+    Cursor *table_find(uint64_t key, LatchMode mode, Transaction *transaction);
+    uint32_t row_count(Transaction *transaction);
+    uint32_t key_range(Transaction *transaction, uint64_t &min_key, uint64_t &max_key);
+    Cursor *internal_node_find(uint32_t page_num, uint64_t key, LatchMode mode, std::vector<uint32_t> &latched_pages);
+    void create_new_root(uint32_t right_child_page_num, Cursor *cursor);
+    Transaction *begin_transaction();
+    void commit_transaction(Transaction *transaction);
+    void rollback_transaction(Transaction *transaction);
+    ~Table();
+
+    friend class Cursor;
+    friend class Database;
+    friend class Index;
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "wal.h"
+
+/* FNV-1a, which can be continued over data that arrives in pieces */
+const uint64_t WAL_CHECKSUM_SEED = 14695981039346656037ULL;
+
+static uint64_t wal_checksum(const char *data, size_t size, uint64_t hash = WAL_CHECKSUM_SEED)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+Reads the log front to back, WAL_READ_CHUNK_SIZE bytes at a time, so
+recovery never holds more than a chunk of it in memory.
+*/
+class WalReader
+{
+private:
+    int file_descriptor;
+    uint64_t length;
+    std::string chunk;
+    uint64_t chunk_offset; // offset of the chunk in the log
+    size_t position;       // within the chunk
+
+public:
+    WalReader(int file_descriptor, uint64_t offset, uint64_t length)
+        : file_descriptor(file_descriptor), length(length), chunk_offset(offset), position(0)
+    {
+    }
+
+    uint64_t offset()
+    {
+        return chunk_offset + position;
+    }
+
+    /* The next size bytes of the log, valid until the next call, or nullptr at its end */
+    const char *read(size_t size)
+    {
+        if (chunk.size() - position < size)
+        {
+            chunk_offset += position;
+            position = 0;
+            size_t chunk_size = std::min<uint64_t>(std::max<size_t>(size, WAL_READ_CHUNK_SIZE), length - chunk_offset);
+            chunk.resize(chunk_size);
+            size_t bytes_read = 0;
+            while (bytes_read < chunk_size)
+            {
+                ssize_t result = pread(file_descriptor, &chunk[bytes_read], chunk_size - bytes_read,
+                                       chunk_offset + bytes_read);
+                if (result == -1)
+                {
+                    std::cout << "Error reading file: " << errno << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                if (result == 0)
+                {
+                    break;
+                }
+                bytes_read += result;
+            }
+            chunk.resize(bytes_read);
+            if (bytes_read < size)
+            {
+                return nullptr;
+            }
+        }
+        const char *data = &chunk[position];
+        position += size;
+        return data;
+    }
+};
+
+Wal::Wal(const char *db_filename)
+    : filename(std::string(db_filename) + "-wal"), page_size(0), page_record_size(0), appended_lsn(0), synced_lsn(0),
+      log_length(0), reclaimed_length(0)
+{
+    file_descriptor = open(filename.c_str(),
+                           O_RDWR |         // Read/Write mode
+                               O_CREAT |    // Create file if it does not exist
+                               O_APPEND,    // Records always go to the end
+                           S_IWUSR |        // User write permission
+                               S_IRUSR      // User read permission
+    );
+    if (file_descriptor < 0)
+    {
+        std::cerr << "Error: cannot open file " << filename << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+uint64_t Wal::recover(uint32_t page_size, uint64_t checkpoint_lsn, uint64_t checkpoint_offset, uint32_t &num_pages,
+                      const std::function<void(uint32_t page_num, uint64_t lsn, const char *image)> &replay_page,
+                      const std::function<void(uint64_t redo_lsn)> &sync_pages)
+{
+    /*
+    checkpoint_lsn and checkpoint_offset come from the db header, whose
+    last checkpoint may be newer than the log's; no commit the db file
+    is missing starts before checkpoint_offset. replay_page is called
+    from several threads at once, sync_pages once they are done.
+    Returns the last LSN in use and raises num_pages to cover every
+    replayed page.
+    */
+    this->page_size = page_size;
+    this->page_record_size = WAL_PAGE_RECORD_HEADER_SIZE + page_size;
+
+    off_t wal_length = lseek(file_descriptor, 0, SEEK_END);
+    log_length = wal_length > 0 ? wal_length : 0;
+    reclaimed_length = std::min(checkpoint_offset, log_length);
+    if (log_length <= checkpoint_offset)
+    {
+        appended_lsn = synced_lsn = checkpoint_lsn > 0 ? checkpoint_lsn - 1 : 0;
+        return appended_lsn;
+    }
+
+    /*
+    Find the newest committed image of every page, stopping at the
+    first torn commit. Images older than a checkpoint's redo LSN are
+    in the db file already. Images are only located here and read
+    again when they are replayed.
+    */
+    WalReader reader(file_descriptor, checkpoint_offset, log_length);
+    std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>> newest_images;
+    std::vector<std::pair<uint32_t, uint64_t>> commit_images; // page records of the commit being read
+    uint64_t commit_checksum = WAL_CHECKSUM_SEED;
+    uint64_t redo_lsn = checkpoint_lsn;
+    uint64_t last_lsn = 0;
+    const char *record;
+    while ((record = reader.read(sizeof(uint32_t))) != nullptr)
+    {
+        uint32_t type;
+        memcpy(&type, record, sizeof(type));
+        /* Page records continue the checksum of their commit, a checkpoint record starts its own */
+        uint64_t checksum = wal_checksum(record, sizeof(type), type == WAL_RECORD_PAGE ? commit_checksum : WAL_CHECKSUM_SEED);
+        if (type == WAL_RECORD_PAGE)
+        {
+            uint64_t image_offset = reader.offset() + sizeof(uint32_t);
+            if ((record = reader.read(page_record_size - sizeof(uint32_t))) == nullptr)
+            {
+                break;
+            }
+            uint32_t page_num;
+            memcpy(&page_num, record, sizeof(page_num));
+            commit_checksum = wal_checksum(record, page_record_size - sizeof(uint32_t), checksum);
+            commit_images.push_back(std::make_pair(page_num, image_offset));
+        }
+        else if (type == WAL_RECORD_COMMIT)
+        {
+            if ((record = reader.read(WAL_COMMIT_RECORD_SIZE - sizeof(uint32_t))) == nullptr)
+            {
+                break;
+            }
+            uint32_t num_pages;
+            uint64_t lsn, stored_checksum;
+            memcpy(&num_pages, record, sizeof(num_pages));
+            memcpy(&lsn, record + sizeof(uint32_t), sizeof(lsn));
+            memcpy(&stored_checksum, record + sizeof(uint32_t) + sizeof(uint64_t), sizeof(stored_checksum));
+            if (num_pages != commit_images.size() || stored_checksum != commit_checksum)
+            {
+                break;
+            }
+
+            if (lsn >= redo_lsn)
+            {
+                for (auto &image : commit_images)
+                {
+                    newest_images[image.first] = std::make_pair(lsn, image.second);
+                }
+            }
+            last_lsn = lsn;
+
+            commit_images.clear();
+            commit_checksum = WAL_CHECKSUM_SEED;
+        }
+        else if (type == WAL_RECORD_CHECKPOINT && commit_images.empty())
+        {
+            if ((record = reader.read(WAL_CHECKPOINT_RECORD_SIZE - sizeof(uint32_t))) == nullptr)
+            {
+                break;
+            }
+            uint64_t stored_checksum;
+            memcpy(&stored_checksum, record + sizeof(uint32_t) + sizeof(uint64_t), sizeof(stored_checksum));
+            if (stored_checksum != wal_checksum(record, sizeof(uint32_t) + sizeof(uint64_t), checksum))
+            {
+                break;
+            }
+            uint64_t checkpoint_redo_lsn;
+            memcpy(&checkpoint_redo_lsn, record + sizeof(uint32_t), sizeof(checkpoint_redo_lsn));
+            redo_lsn = std::max(redo_lsn, checkpoint_redo_lsn);
+            for (auto it = newest_images.begin(); it != newest_images.end();)
+            {
+                it = it->second.first < redo_lsn ? newest_images.erase(it) : std::next(it);
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (redo_lsn > 0 && redo_lsn - 1 > last_lsn)
+    {
+        last_lsn = redo_lsn - 1;
+    }
+
+    /* Every page is written at most once, so pages can be redone in any order */
+    std::vector<std::pair<uint32_t, std::pair<uint64_t, uint64_t>>> pages(newest_images.begin(), newest_images.end());
+    for (auto &page : pages)
+    {
+        num_pages = std::max(num_pages, page.first + 1);
+    }
+    uint32_t num_threads = std::max(1u, std::min(std::thread::hardware_concurrency(), (uint32_t)WAL_REPLAY_MAX_THREADS));
+    num_threads = std::min(num_threads, (uint32_t)pages.size());
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([this, &pages, &replay_page, num_threads, t]()
+                             {
+                                 std::string image(this->page_size, '\0');
+                                 for (size_t i = t; i < pages.size(); i += num_threads)
+                                 {
+                                     ssize_t bytes_read = pread(file_descriptor, &image[0], this->page_size,
+                                                                pages[i].second.second);
+                                     if (bytes_read != (ssize_t)this->page_size)
+                                     {
+                                         std::cout << "Error reading file: " << errno << std::endl;
+                                         exit(EXIT_FAILURE);
+                                     }
+                                     replay_page(pages[i].first, pages[i].second.first, image.data());
+                                 }
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    /* The replayed pages must be durable before the log is dropped */
+    sync_pages(last_lsn + 1);
+    checkpoint(last_lsn + 1, true);
+    appended_lsn = synced_lsn = last_lsn;
+
+    return last_lsn;
+}
+void Wal::append_page(uint32_t page_num, void *page)
+{
+    /* Called with the pager's commit mutex held */
+    buffer.append((const char *)&WAL_RECORD_PAGE, sizeof(uint32_t));
+    buffer.append((const char *)&page_num, sizeof(page_num));
+    buffer.append((const char *)page, page_size);
+}
+void Wal::append_commit(uint64_t lsn, bool sync)
+{
+    commit_offsets.push_back(std::make_pair(lsn, log_length));
+    uint32_t num_pages = buffer.size() / page_record_size;
+    uint64_t checksum = wal_checksum(buffer.data(), buffer.size());
+    buffer.append((const char *)&WAL_RECORD_COMMIT, sizeof(uint32_t));
+    buffer.append((const char *)&num_pages, sizeof(num_pages));
+    buffer.append((const char *)&lsn, sizeof(lsn));
+    buffer.append((const char *)&checksum, sizeof(checksum));
+    write_buffer(sync);
+
+    appended_lsn = lsn;
+    if (sync)
+    {
+        synced_lsn = lsn;
+    }
+}
+void Wal::sync_to(uint64_t lsn)
+{
+    if (synced_lsn >= lsn)
+    {
+        return;
+    }
+    if (fsync(file_descriptor) == -1)
+    {
+        std::cout << "Error syncing log: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    synced_lsn = appended_lsn;
+}
+uint64_t Wal::redo_offset(uint64_t redo_lsn)
+{
+    /* Where the first commit at or after redo_lsn starts, or the end of the log */
+    auto commit = std::lower_bound(commit_offsets.begin(), commit_offsets.end(), std::make_pair(redo_lsn, (uint64_t)0));
+    return commit != commit_offsets.end() ? commit->second : log_length;
+}
+void Wal::checkpoint(uint64_t redo_lsn, bool truncate)
+{
+    /*
+    Called once every commit before redo_lsn is durable in the db
+    file and the header points recovery at redo_offset(redo_lsn). If
+    that is every commit in the log, none of the log is needed anymore
+    but the checkpoint itself. Otherwise the log before the redo
+    offset is given back to the file system as a hole, while the
+    offsets of the records after it stay what the header says.
+    */
+    if (truncate)
+    {
+        if (ftruncate(file_descriptor, 0) == -1)
+        {
+            std::cout << "Error truncating log: " << errno << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        log_length = reclaimed_length = 0;
+    }
+    else
+    {
+        uint64_t offset = redo_offset(redo_lsn);
+        if (offset > reclaimed_length)
+        {
+            /* File systems without holes just keep the space */
+            if (fallocate(file_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, reclaimed_length,
+                          offset - reclaimed_length) == -1 &&
+                errno != EOPNOTSUPP)
+            {
+                std::cout << "Error reclaiming log: " << errno << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            reclaimed_length = offset;
+        }
+    }
+    while (!commit_offsets.empty() && commit_offsets.front().first < redo_lsn)
+    {
+        commit_offsets.pop_front();
+    }
+
+    uint32_t unused = 0;
+    buffer.append((const char *)&WAL_RECORD_CHECKPOINT, sizeof(uint32_t));
+    buffer.append((const char *)&unused, sizeof(unused));
+    buffer.append((const char *)&redo_lsn, sizeof(redo_lsn));
+    uint64_t checksum = wal_checksum(buffer.data(), buffer.size());
+    buffer.append((const char *)&checksum, sizeof(checksum));
+    write_buffer(true);
+    synced_lsn = appended_lsn;
+}
+void Wal::write_buffer(bool sync)
+{
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t bytes_written = write(file_descriptor, buffer.data() + written, buffer.size() - written);
+        if (bytes_written == -1)
+        {
+            std::cout << "Error writing: " << errno << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        written += bytes_written;
+    }
+    log_length += written;
+    buffer.clear();
+
+    if (sync && fsync(file_descriptor) == -1)
+    {
+        std::cout << "Error syncing log: " << errno << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+Wal::~Wal()
+{
+    close(file_descriptor);
+}
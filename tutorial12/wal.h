@@ -0,0 +1,87 @@
+#ifndef DB_WAL_H
+#define DB_WAL_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "node.h"
+
+/*
+Record types of the write-ahead log. A commit is written as one
+page record per changed page followed by a commit record. The
+commit's timestamp serves as its log sequence number (LSN).
+
+page record:       type, page number, page image (page size bytes)
+commit record:     type, number of page records, LSN,
+                   checksum of the page records of the commit
+checkpoint record: type, unused, redo LSN, checksum of the record
+*/
+const uint32_t WAL_RECORD_PAGE = 1;
+const uint32_t WAL_RECORD_COMMIT = 2;
+const uint32_t WAL_RECORD_CHECKPOINT = 3;
+
+const uint32_t WAL_PAGE_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+const uint32_t WAL_COMMIT_RECORD_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+const uint32_t WAL_CHECKPOINT_RECORD_SIZE = WAL_COMMIT_RECORD_SIZE;
+
+/* Threads that write replayed pages back to the db file */
+#define WAL_REPLAY_MAX_THREADS 8
+/* Recovery reads the log this many bytes at a time */
+#define WAL_READ_CHUNK_SIZE (1 << 20)
+
+/*
+Wal is the redo log that lives next to the database file as
+"<filename>-wal". Every commit appends the after-images of the pages
+it changed; the pages themselves reach the db file later, see Pager.
+Every page also carries the LSN of the last commit that changed it,
+and may only be written to the db file once the log is synced up to
+that LSN.
+
+A checkpoint record says that every commit before its redo LSN is in
+the db file. The db header keeps the redo LSN of the last checkpoint
+and the offset of the first commit at or after it, see redo_offset.
+Every checkpoint frees the log before that offset. Once every commit
+is in the db file, the log is truncated to just the checkpoint
+record, which also carries the LSN sequence over to the next
+session. Closing the table cleanly always ends that way.
+Anything after the last checkpoint means the table was not closed
+cleanly: recovery reads the log in chunks from the offset in the
+header and hands the newest image of every page changed since the
+checkpoint to the pager, in parallel, which writes it unless the
+page in the file already has that LSN. Commits whose commit record
+is missing or does not match its checksum were cut off by the crash
+and are ignored.
+*/
+class Wal
+{
+private:
+    std::string filename;
+    int file_descriptor;
+    uint32_t page_size;
+    uint32_t page_record_size;
+    std::string buffer;
+    uint64_t appended_lsn;
+    uint64_t synced_lsn;
+    uint64_t log_length; // where the next record goes
+    uint64_t reclaimed_length; // the log before this offset is a hole
+    std::deque<std::pair<uint64_t, uint64_t>> commit_offsets; // LSN and offset of the commits since the redo LSN
+
+    void write_buffer(bool sync);
+
+public:
+    Wal(const char *db_filename);
+
+    uint64_t recover(uint32_t page_size, uint64_t checkpoint_lsn, uint64_t checkpoint_offset, uint32_t &num_pages,
+                     const std::function<void(uint32_t page_num, uint64_t lsn, const char *image)> &replay_page,
+                     const std::function<void(uint64_t redo_lsn)> &sync_pages);
+    void append_page(uint32_t page_num, void *page);
+    void append_commit(uint64_t lsn, bool sync);
+    void sync_to(uint64_t lsn);
+    uint64_t redo_offset(uint64_t redo_lsn);
+    void checkpoint(uint64_t redo_lsn, bool truncate);
+    ~Wal();
+};
+
+#endif